@@ -0,0 +1,388 @@
+#include "auparser.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Binary format writer and reader, see auparser.h for the layout.
+//
+// Sections are collected in separate buffers while patterns are added,
+// and written one after another when finishing. Records are fixed size
+// and made only of 32-bit or smaller fields, so every section stays
+// 4 byte aligned without padding.
+
+#define COUNT(buf, type) ((uint32_t)((buf).size / sizeof(type)))
+
+static const au_bin_str_t no_str = { AU_BIN_NONE, 0 };
+
+static au_bin_str_t add_string(au_bin_writer_t *w, const char *str, size_t len)
+{
+  au_bin_str_t res = { (uint32_t)w->strings.size, (uint32_t)len };
+  au_buf_put(&w->strings, str, len);
+  return res;
+}
+
+/// Start pattern record, strings are added to the string table
+static au_bin_pattern_t new_record(au_bin_writer_t *w, const au_bin_source_t *src)
+{
+  au_bin_pattern_t rec = {0};
+  rec.pattern = add_string(w, src->pat, src->patlen);
+  rec.cmd = src->cmd != NULL ? add_string(w, src->cmd, src->cmdlen) : no_str;
+  rec.error = no_str;
+  rec.lnum = (uint32_t)src->lnum;
+  rec.tokens = COUNT(w->tokens, au_bin_token_t);
+  rec.branches = COUNT(w->branches, au_bin_branch_t);
+  rec.groups = COUNT(w->groups, au_dag_group_t);
+
+  // patterns from the same file share the file name
+  if (src->file == NULL) {
+    rec.file = no_str;
+  } else if (src->file == w->file) {
+    rec.file = (au_bin_str_t){ w->fileoff, (uint32_t)strlen(src->file) };
+  } else {
+    rec.file = add_string(w, src->file, strlen(src->file));
+    w->file = src->file;
+    w->fileoff = rec.file.off;
+  }
+  return rec;
+}
+
+static void add_tokens(au_bin_writer_t *w, au_bin_pattern_t *rec, const token_t *toks, const char *pat)
+{
+  for (const token_t *t = toks; t->type; ++t) {
+    au_bin_token_t tok = {
+      .type = t->type,
+      .lvl = t->lvl,
+      // empty tokens don't point into the pattern
+      .value = {
+        rec->pattern.off + (uint32_t)(t->type == Empty ? 0 : t->beg - pat),
+        (uint32_t)t->len,
+      },
+    };
+    au_buf_put(&w->tokens, (const char *)&tok, sizeof(tok));
+    ++rec->ntokens;
+  }
+}
+
+static void add_branch(au_bin_writer_t *w, au_bin_pattern_t *rec, const token_t **branch, const token_t *toks)
+{
+  au_bin_branch_t br = { COUNT(w->refs, uint32_t), 0 };
+  for (const token_t **p = branch; *p != NULL; ++p) {
+    uint32_t ref = rec->tokens + (uint32_t)(*p - toks);
+    au_buf_put(&w->refs, (const char *)&ref, sizeof(ref));
+    ++br.nrefs;
+  }
+  au_buf_put(&w->branches, (const char *)&br, sizeof(br));
+  ++rec->nbranches;
+}
+
+/// Add unrolled branches, token indexes are relative to the pattern
+static void add_branches(au_bin_writer_t *w, au_bin_pattern_t *rec, const au_branches_t *br)
+{
+  for (size_t i = 0; i < br->nbranches; ++i) {
+    au_bin_branch_t b = { COUNT(w->refs, uint32_t), br->offs[i + 1] - br->offs[i] };
+    for (uint32_t k = br->offs[i]; k < br->offs[i + 1]; ++k) {
+      uint32_t ref = rec->tokens + br->refs[k];
+      au_buf_put(&w->refs, (const char *)&ref, sizeof(ref));
+    }
+    au_buf_put(&w->branches, (const char *)&b, sizeof(b));
+  }
+  rec->nbranches += br->nbranches;
+}
+
+/// Add factorized form, its indexes are rebased on tokens and groups of the writer
+static void add_dag(au_bin_writer_t *w, au_bin_pattern_t *rec, const au_dag_t *dag)
+{
+  uint32_t seqbase = COUNT(w->seqs, au_dag_seq_t);
+  uint32_t itembase = COUNT(w->items, uint32_t);
+  for (size_t i = 0; i < dag->ngroups; ++i) {
+    au_dag_group_t g = { dag->groups[i].seqs + seqbase, dag->groups[i].nseqs };
+    au_buf_put(&w->groups, (const char *)&g, sizeof(g));
+  }
+  for (size_t i = 0; i < dag->nseqs; ++i) {
+    au_dag_seq_t seq = { dag->seqs[i].items + itembase, dag->seqs[i].nitems };
+    au_buf_put(&w->seqs, (const char *)&seq, sizeof(seq));
+  }
+  for (size_t i = 0; i < dag->nitems; ++i) {
+    uint32_t item = dag->items[i];
+    item = (item & AU_DAG_GROUP) ? item + rec->groups : item + rec->tokens;
+    au_buf_put(&w->items, (const char *)&item, sizeof(item));
+  }
+  rec->ngroups = (uint32_t)dag->ngroups;
+  rec->flags |= AU_BIN_FACTORIZED;
+}
+
+bool au_bin_add(au_ctx_t *ctx, au_bin_writer_t *w, const au_bin_source_t *src, uint32_t flags)
+{
+  au_bin_pattern_t rec = new_record(w, src);
+
+  bool ok = false;
+  token_t *toks = tokenize_n(ctx, src->pat, src->patlen);
+  if (toks == NULL)
+    goto done;
+  add_tokens(w, &rec, toks, src->pat);
+
+  if (flags & AU_BIN_FACTORIZED) {
+    au_dag_t dag;
+    if (!au_unroll_dag(ctx, toks, &dag))
+      goto done;
+    add_dag(w, &rec, &dag);
+  }
+
+  if (flags & AU_BIN_UNROLLED) {
+    // branches before an error are kept, big patterns are unrolled in parallel
+    au_branches_t br;
+    ok = au_unroll_flat(ctx, toks, &br);
+    if (br.offs == NULL)
+      goto done;
+    rec.flags |= AU_BIN_UNROLLED;
+    add_branches(w, &rec, &br);
+  } else {
+    ok = true;
+  }
+
+done:
+  if (!ok)
+    rec.error = add_string(w, ctx->error, strlen(ctx->error));
+  au_buf_put(&w->patterns, (const char *)&rec, sizeof(rec));
+  return ok;
+}
+
+void au_bin_add_entry(au_bin_writer_t *w, const au_cache_entry_t *e)
+{
+  au_bin_pattern_t rec = new_record(w, &(au_bin_source_t){ .pat = e->pat, .patlen = e->patlen });
+  if (e->toks != NULL)
+    add_tokens(w, &rec, e->toks, e->pat);
+  if (e->res != NULL)
+    rec.flags |= AU_BIN_UNROLLED;
+  for (size_t i = 0; i < e->nres; ++i)
+    add_branch(w, &rec, e->res[i], e->toks);
+  if (e->error != NULL)
+    rec.error = add_string(w, e->error, strlen(e->error));
+  au_buf_put(&w->patterns, (const char *)&rec, sizeof(rec));
+}
+
+static inline void rebase_str(au_bin_str_t *str, uint32_t base)
+{
+  if (str->off != AU_BIN_NONE)
+    str->off += base;
+}
+
+static void append_buf(au_buf_t *dst, const au_buf_t *src)
+{
+  if (src->size > 0)
+    au_buf_put(dst, src->data, src->size);
+  dst->failed |= src->failed;
+}
+
+void au_bin_append(au_bin_writer_t *dst, au_bin_writer_t *src)
+{
+  uint32_t strbase = (uint32_t)dst->strings.size;
+  uint32_t tokbase = COUNT(dst->tokens, au_bin_token_t);
+  uint32_t brbase = COUNT(dst->branches, au_bin_branch_t);
+  uint32_t refbase = COUNT(dst->refs, uint32_t);
+  uint32_t groupbase = COUNT(dst->groups, au_dag_group_t);
+  uint32_t seqbase = COUNT(dst->seqs, au_dag_seq_t);
+  uint32_t itembase = COUNT(dst->items, uint32_t);
+
+  au_bin_pattern_t *pats = (au_bin_pattern_t *)src->patterns.data;
+  for (uint32_t i = 0; i < COUNT(src->patterns, au_bin_pattern_t); ++i) {
+    rebase_str(&pats[i].pattern, strbase);
+    rebase_str(&pats[i].cmd, strbase);
+    rebase_str(&pats[i].file, strbase);
+    rebase_str(&pats[i].error, strbase);
+    pats[i].tokens += tokbase;
+    pats[i].branches += brbase;
+    pats[i].groups += groupbase;
+  }
+  au_bin_token_t *toks = (au_bin_token_t *)src->tokens.data;
+  for (uint32_t i = 0; i < COUNT(src->tokens, au_bin_token_t); ++i)
+    toks[i].value.off += strbase;
+  au_bin_branch_t *brs = (au_bin_branch_t *)src->branches.data;
+  for (uint32_t i = 0; i < COUNT(src->branches, au_bin_branch_t); ++i)
+    brs[i].refs += refbase;
+  uint32_t *refs = (uint32_t *)src->refs.data;
+  for (uint32_t i = 0; i < COUNT(src->refs, uint32_t); ++i)
+    refs[i] += tokbase;
+  au_dag_group_t *groups = (au_dag_group_t *)src->groups.data;
+  for (uint32_t i = 0; i < COUNT(src->groups, au_dag_group_t); ++i)
+    groups[i].seqs += seqbase;
+  au_dag_seq_t *seqs = (au_dag_seq_t *)src->seqs.data;
+  for (uint32_t i = 0; i < COUNT(src->seqs, au_dag_seq_t); ++i)
+    seqs[i].items += itembase;
+  uint32_t *items = (uint32_t *)src->items.data;
+  for (uint32_t i = 0; i < COUNT(src->items, uint32_t); ++i)
+    items[i] += (items[i] & AU_DAG_GROUP) ? groupbase : tokbase;
+
+  append_buf(&dst->patterns, &src->patterns);
+  append_buf(&dst->tokens, &src->tokens);
+  append_buf(&dst->branches, &src->branches);
+  append_buf(&dst->refs, &src->refs);
+  append_buf(&dst->groups, &src->groups);
+  append_buf(&dst->seqs, &src->seqs);
+  append_buf(&dst->items, &src->items);
+  append_buf(&dst->strings, &src->strings);
+
+  // the file name of src may not outlive it, don't share it
+  dst->file = NULL;
+  au_bin_free(src);
+}
+
+void au_bin_append_copy(au_bin_writer_t *dst, const au_bin_writer_t *src)
+{
+  au_bin_writer_t copy = {0};
+  append_buf(&copy.patterns, &src->patterns);
+  append_buf(&copy.tokens, &src->tokens);
+  append_buf(&copy.branches, &src->branches);
+  append_buf(&copy.refs, &src->refs);
+  append_buf(&copy.groups, &src->groups);
+  append_buf(&copy.seqs, &src->seqs);
+  append_buf(&copy.items, &src->items);
+  append_buf(&copy.strings, &src->strings);
+  au_bin_append(dst, &copy);
+}
+
+bool au_bin_finish(au_bin_writer_t *w, au_buf_t *out)
+{
+  const au_buf_t *sections[] = {
+    &w->patterns, &w->tokens, &w->branches, &w->refs, &w->groups, &w->seqs, &w->items, &w->strings,
+  };
+  for (size_t i = 0; i < sizeof(sections) / sizeof(sections[0]); ++i) {
+    if (sections[i]->failed || sections[i]->size > UINT32_MAX)
+      return false;
+  }
+
+  au_bin_header_t header = {
+    .version = AU_BIN_VERSION,
+    .parser = AU_PARSER_VERSION,
+    .npatterns = COUNT(w->patterns, au_bin_pattern_t),
+    .ntokens = COUNT(w->tokens, au_bin_token_t),
+    .nbranches = COUNT(w->branches, au_bin_branch_t),
+    .nrefs = COUNT(w->refs, uint32_t),
+    .ngroups = COUNT(w->groups, au_dag_group_t),
+    .nseqs = COUNT(w->seqs, au_dag_seq_t),
+    .nitems = COUNT(w->items, uint32_t),
+    .strsize = (uint32_t)w->strings.size,
+  };
+  memcpy(header.magic, AU_BIN_MAGIC, sizeof(header.magic));
+  au_buf_put(out, (const char *)&header, sizeof(header));
+  for (size_t i = 0; i < sizeof(sections) / sizeof(sections[0]); ++i) {
+    if (sections[i]->size > 0)
+      au_buf_put(out, sections[i]->data, sections[i]->size);
+  }
+  return !out->failed;
+}
+
+void au_bin_free(au_bin_writer_t *w)
+{
+  au_buf_free(&w->patterns);
+  au_buf_free(&w->tokens);
+  au_buf_free(&w->branches);
+  au_buf_free(&w->refs);
+  au_buf_free(&w->groups);
+  au_buf_free(&w->seqs);
+  au_buf_free(&w->items);
+  au_buf_free(&w->strings);
+  w->file = NULL;
+  w->fileoff = 0;
+}
+
+static inline bool str_ok(au_bin_str_t str, uint32_t strsize)
+{
+  return str.off == AU_BIN_NONE || (uint64_t)str.off + str.len <= strsize;
+}
+
+static inline bool range_ok(uint32_t beg, uint32_t len, uint32_t size)
+{
+  return (uint64_t)beg + len <= size;
+}
+
+bool au_bin_open(au_bin_t *bin, const void *data, size_t size, const char **error)
+{
+#define FAIL(msg) \
+  do { \
+    *error = (msg); \
+    return false; \
+  } while (0)
+
+  if (((uintptr_t)data & 3) != 0)
+    FAIL("data not aligned");
+  const au_bin_header_t *h = data;
+  if (size < sizeof(au_bin_header_t) || memcmp(h->magic, AU_BIN_MAGIC, 4) != 0)
+    FAIL("not a binary pattern file");
+  if (h->version != AU_BIN_VERSION)
+    FAIL("unsupported version");
+
+  uint64_t expected = sizeof(au_bin_header_t)
+    + (uint64_t)h->npatterns * sizeof(au_bin_pattern_t)
+    + (uint64_t)h->ntokens * sizeof(au_bin_token_t)
+    + (uint64_t)h->nbranches * sizeof(au_bin_branch_t)
+    + (uint64_t)h->nrefs * sizeof(uint32_t)
+    + (uint64_t)h->ngroups * sizeof(au_dag_group_t)
+    + (uint64_t)h->nseqs * sizeof(au_dag_seq_t)
+    + (uint64_t)h->nitems * sizeof(uint32_t)
+    + h->strsize;
+  if (expected != size)
+    FAIL("invalid file size");
+
+  const char *p = (const char *)data + sizeof(au_bin_header_t);
+  bin->header = h;
+  bin->patterns = (const au_bin_pattern_t *)p;
+  p += (size_t)h->npatterns * sizeof(au_bin_pattern_t);
+  bin->tokens = (const au_bin_token_t *)p;
+  p += (size_t)h->ntokens * sizeof(au_bin_token_t);
+  bin->branches = (const au_bin_branch_t *)p;
+  p += (size_t)h->nbranches * sizeof(au_bin_branch_t);
+  bin->refs = (const uint32_t *)p;
+  p += (size_t)h->nrefs * sizeof(uint32_t);
+  bin->groups = (const au_dag_group_t *)p;
+  p += (size_t)h->ngroups * sizeof(au_dag_group_t);
+  bin->seqs = (const au_dag_seq_t *)p;
+  p += (size_t)h->nseqs * sizeof(au_dag_seq_t);
+  bin->items = (const uint32_t *)p;
+  p += (size_t)h->nitems * sizeof(uint32_t);
+  bin->strings = p;
+
+  for (uint32_t i = 0; i < h->npatterns; ++i) {
+    const au_bin_pattern_t *pat = &bin->patterns[i];
+    if (pat->pattern.off == AU_BIN_NONE || !str_ok(pat->pattern, h->strsize)
+        || !str_ok(pat->cmd, h->strsize) || !str_ok(pat->file, h->strsize)
+        || !str_ok(pat->error, h->strsize))
+      FAIL("invalid string");
+    if (!range_ok(pat->tokens, pat->ntokens, h->ntokens)
+        || !range_ok(pat->branches, pat->nbranches, h->nbranches)
+        || !range_ok(pat->groups, pat->ngroups, h->ngroups))
+      FAIL("invalid pattern");
+  }
+  for (uint32_t i = 0; i < h->ntokens; ++i) {
+    if (bin->tokens[i].type == End || bin->tokens[i].type > Empty
+        || bin->tokens[i].value.off == AU_BIN_NONE
+        || !str_ok(bin->tokens[i].value, h->strsize))
+      FAIL("invalid token");
+  }
+  for (uint32_t i = 0; i < h->nbranches; ++i) {
+    if (!range_ok(bin->branches[i].refs, bin->branches[i].nrefs, h->nrefs))
+      FAIL("invalid branch");
+  }
+  for (uint32_t i = 0; i < h->nrefs; ++i) {
+    if (bin->refs[i] >= h->ntokens)
+      FAIL("invalid token reference");
+  }
+  for (uint32_t i = 0; i < h->ngroups; ++i) {
+    if (!range_ok(bin->groups[i].seqs, bin->groups[i].nseqs, h->nseqs))
+      FAIL("invalid group");
+  }
+  for (uint32_t i = 0; i < h->nseqs; ++i) {
+    if (!range_ok(bin->seqs[i].items, bin->seqs[i].nitems, h->nitems))
+      FAIL("invalid sequence");
+  }
+  for (uint32_t i = 0; i < h->nitems; ++i) {
+    uint32_t item = bin->items[i];
+    if ((item & AU_DAG_GROUP) ? (item & ~AU_DAG_GROUP) >= h->ngroups : item >= h->ntokens)
+      FAIL("invalid item");
+  }
+  return true;
+
+#undef FAIL
+}
@@ -0,0 +1,350 @@
+#include "auparser.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Memoized tokenize and unroll results, and their persistent store,
+// see auparser.h.
+//
+// Entries and everything they point to live in the cache arena. The
+// table is open addressing with linear probing, its size is a power of
+// two and it's kept at most 3/4 full. The store index works the same
+// way, with pattern indexes instead of entries.
+
+#define CACHE_MIN_CAP (64)
+
+/// FNV-1a, seeded with parser version so stored hashes change with it
+static uint64_t hash_bytes(const char *str, size_t len)
+{
+  uint64_t h = 0xcbf29ce484222325ULL ^ AU_PARSER_VERSION;
+  for (size_t i = 0; i < len; ++i) {
+    h ^= (unsigned char)str[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+void au_cache_init(au_cache_t *cache)
+{
+  memset(cache, 0, sizeof(au_cache_t));
+}
+
+void au_cache_free(au_cache_t *cache)
+{
+  au_arena_free(&cache->arena);
+  free(cache->slots);
+  au_cache_init(cache);
+}
+
+static bool grow(au_cache_t *cache)
+{
+  size_t ncap = cache->cap ? cache->cap * 2 : CACHE_MIN_CAP;
+  au_cache_entry_t **slots = calloc(ncap, sizeof(au_cache_entry_t *));
+  if (slots == NULL)
+    return false;
+  for (size_t i = 0; i < cache->cap; ++i) {
+    au_cache_entry_t *e = cache->slots[i];
+    if (e == NULL)
+      continue;
+    size_t j = e->hash & (ncap - 1);
+    while (slots[j] != NULL)
+      j = (j + 1) & (ncap - 1);
+    slots[j] = e;
+  }
+  free(cache->slots);
+  cache->slots = slots;
+  cache->cap = ncap;
+  return true;
+}
+
+/// Copy tokens into the cache, pointing into the cached pattern
+static bool copy_tokens(au_cache_t *cache, au_cache_entry_t *e, const token_t *toks, const char *pat)
+{
+  size_t n = 0;
+  while (toks[n].type)
+    ++n;
+  token_t *res = au_arena_alloc(&cache->arena, (n + 1) * sizeof(token_t));
+  if (res == NULL)
+    return false;
+  for (size_t i = 0; i <= n; ++i) {
+    res[i] = toks[i];
+    // empty tokens don't point into the pattern
+    uintptr_t off = (uintptr_t)toks[i].beg - (uintptr_t)pat;
+    if (toks[i].beg != NULL && off <= e->patlen)
+      res[i].beg = e->pat + off;
+  }
+  e->toks = res;
+  return true;
+}
+
+/// Unroll cached tokens. Branches before an error are kept.
+/// @return     false if memory allocation failed
+static bool unroll_entry(au_ctx_t *ctx, au_cache_t *cache, au_cache_entry_t *e)
+{
+  au_branches_t br;
+  e->unrolled = true;
+  if (!au_unroll_flat(ctx, e->toks, &br)) {
+    e->error = ctx->error;
+    if (br.offs == NULL)
+      return true;
+  }
+  // token indexes stay valid for the copy of tokens in the cache
+  e->res = au_branches_expand(&cache->arena, &br, e->toks);
+  e->nres = br.nbranches;
+  return e->res != NULL;
+}
+
+static bool store_find(const au_store_t *store, uint64_t hash,
+    const char *pat, size_t len, uint32_t *idx)
+{
+  if (store->cap == 0)
+    return false;
+  for (size_t i = hash & (store->cap - 1); store->index[i] != 0; i = (i + 1) & (store->cap - 1)) {
+    uint32_t k = store->index[i] - 1;
+    au_bin_str_t str = store->bin.patterns[k].pattern;
+    if (store->hashes[k] == hash && str.len == len
+        && memcmp(store->bin.strings + str.off, pat, len) == 0) {
+      *idx = k;
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Rebuild entry from its stored records
+static bool load_entry(au_ctx_t *ctx, au_cache_t *cache, au_cache_entry_t *e, uint32_t idx)
+{
+  const au_bin_t *bin = &cache->store->bin;
+  const au_bin_pattern_t *p = &bin->patterns[idx];
+
+  if (p->error.off != AU_BIN_NONE) {
+    char *error = au_arena_alloc(&cache->arena, p->error.len + 1);
+    if (error == NULL)
+      return false;
+    memcpy(error, bin->strings + p->error.off, p->error.len);
+    error[p->error.len] = '\0';
+    e->error = error;
+    // tokenize errors come without tokens
+    if (p->ntokens == 0 && !(p->flags & AU_BIN_UNROLLED))
+      return true;
+  }
+
+  token_t *toks = au_arena_alloc(&cache->arena, (p->ntokens + 1) * sizeof(token_t));
+  if (toks == NULL)
+    return false;
+  for (uint32_t i = 0; i < p->ntokens; ++i) {
+    const au_bin_token_t *t = &bin->tokens[p->tokens + i];
+    toks[i] = (token_t){
+      .type = t->type,
+      .beg = t->type == Empty ? "" : e->pat + (t->value.off - p->pattern.off),
+      .len = t->value.len,
+      .lvl = t->lvl,
+    };
+  }
+  toks[p->ntokens] = (token_t){ .type = End, .beg = e->pat + e->patlen };
+  e->toks = toks;
+  if (!(p->flags & AU_BIN_UNROLLED))
+    return true;
+
+  // results may have been stored without a limit, fail like unroll would
+  size_t count;
+  if (ctx->unroll_max != 0 && au_unroll_count(ctx, toks, &count) && count > ctx->unroll_max) {
+    e->error = "too many branches";
+    e->unrolled = true;
+    return true;
+  }
+
+  const token_t ***res = au_arena_alloc(&cache->arena, (p->nbranches + 1) * sizeof(const token_t**));
+  if (res == NULL)
+    return false;
+  for (uint32_t i = 0; i < p->nbranches; ++i) {
+    const au_bin_branch_t *br = &bin->branches[p->branches + i];
+    const token_t **buf = au_arena_alloc(&cache->arena, (br->nrefs + 1) * sizeof(const token_t*));
+    if (buf == NULL)
+      return false;
+    for (uint32_t j = 0; j < br->nrefs; ++j)
+      buf[j] = &toks[bin->refs[br->refs + j] - p->tokens];
+    buf[br->nrefs] = NULL;
+    res[i] = buf;
+  }
+  res[p->nbranches] = NULL;
+  e->res = res;
+  e->nres = p->nbranches;
+  e->unrolled = true;
+  return true;
+}
+
+const au_cache_entry_t *au_cache_get(au_ctx_t *ctx, au_cache_t *cache,
+    const char *pat, size_t len, bool unroll)
+{
+  if (cache->size + 1 > cache->cap / 4 * 3 && !grow(cache)) {
+    ctx->error = "malloc";
+    return NULL;
+  }
+
+  uint64_t hash = hash_bytes(pat, len);
+  size_t i = hash & (cache->cap - 1);
+  au_cache_entry_t *e;
+  for (; (e = cache->slots[i]) != NULL; i = (i + 1) & (cache->cap - 1)) {
+    if (e->hash == hash && e->patlen == len && memcmp(e->pat, pat, len) == 0)
+      break;
+  }
+
+  if (e != NULL) {
+    ++cache->hits;
+  } else {
+    ++cache->misses;
+    e = au_arena_alloc(&cache->arena, sizeof(au_cache_entry_t));
+    char *copy = au_arena_alloc(&cache->arena, len + 1);
+    if (e == NULL || copy == NULL)
+      goto fail;
+    memcpy(copy, pat, len);
+    copy[len] = '\0';
+    *e = (au_cache_entry_t){ .pat = copy, .patlen = len, .hash = hash };
+
+    uint32_t idx;
+    if (cache->store != NULL && store_find(cache->store, hash, pat, len, &idx)) {
+      if (!load_entry(ctx, cache, e, idx))
+        goto fail;
+      ++cache->loaded;
+    } else {
+      token_t *toks = tokenize_n(ctx, pat, len);
+      if (toks == NULL)
+        e->error = ctx->error;
+      else if (!copy_tokens(cache, e, toks, pat))
+        goto fail;
+    }
+    cache->slots[i] = e;
+    ++cache->size;
+  }
+
+  if (unroll && !e->unrolled && e->toks != NULL && !unroll_entry(ctx, cache, e))
+    goto fail;
+  return e;
+
+fail:
+  ctx->error = "malloc";
+  return NULL;
+}
+
+bool au_cache_set_data(au_cache_t *cache, const au_cache_entry_t *entry, const char *data, size_t size)
+{
+  // entries are only handed out as const to keep them from being modified by accident
+  au_cache_entry_t *e = (au_cache_entry_t *)entry;
+  char *copy = au_arena_alloc(&cache->arena, size);
+  if (copy == NULL)
+    return false;
+  if (size > 0)
+    memcpy(copy, data, size);
+  e->data = copy;
+  e->size = size;
+  return true;
+}
+
+void au_cache_save(const au_cache_t *cache, au_bin_writer_t *w)
+{
+  for (size_t i = 0; i < cache->cap; ++i) {
+    const au_cache_entry_t *e = cache->slots[i];
+    // failing to start unrolling depends on the branch limit, so it isn't saved
+    if (e == NULL || (e->unrolled && e->toks != NULL && e->res == NULL))
+      continue;
+    au_bin_add_entry(w, e);
+  }
+}
+
+bool au_store_open(au_store_t *store, const char *path, const char **error)
+{
+  memset(store, 0, sizeof(au_store_t));
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    *error = errno == ENOENT ? AU_STORE_MISSING : "open";
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    *error = "empty file";
+    return false;
+  }
+  void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    *error = "mmap";
+    return false;
+  }
+  store->data = data;
+  store->size = st.st_size;
+
+  if (!au_bin_open(&store->bin, data, st.st_size, error))
+    goto fail;
+  // results of other parser versions can be different
+  if (store->bin.header->parser != AU_PARSER_VERSION) {
+    *error = "parser version mismatch";
+    goto fail;
+  }
+  // tokens and branches are rebuilt relative to their pattern
+  for (uint32_t i = 0; i < store->bin.header->npatterns; ++i) {
+    const au_bin_pattern_t *p = &store->bin.patterns[i];
+    for (uint32_t j = 0; j < p->ntokens; ++j) {
+      au_bin_str_t v = store->bin.tokens[p->tokens + j].value;
+      if (v.off < p->pattern.off || (uint64_t)v.off + v.len > (uint64_t)p->pattern.off + p->pattern.len) {
+        *error = "invalid token";
+        goto fail;
+      }
+    }
+    for (uint32_t j = 0; j < p->nbranches; ++j) {
+      const au_bin_branch_t *br = &store->bin.branches[p->branches + j];
+      for (uint32_t k = 0; k < br->nrefs; ++k) {
+        uint32_t ref = store->bin.refs[br->refs + k];
+        if (ref < p->tokens || ref - p->tokens >= p->ntokens) {
+          *error = "invalid token reference";
+          goto fail;
+        }
+      }
+    }
+  }
+
+  uint32_t n = store->bin.header->npatterns;
+  store->cap = 16;
+  while (store->cap < (size_t)n * 2)
+    store->cap *= 2;
+  store->index = calloc(store->cap, sizeof(uint32_t));
+  store->hashes = malloc((n > 0 ? n : 1) * sizeof(uint64_t));
+  if (store->index == NULL || store->hashes == NULL) {
+    *error = "malloc";
+    goto fail;
+  }
+  for (uint32_t k = 0; k < n; ++k) {
+    au_bin_str_t str = store->bin.patterns[k].pattern;
+    uint64_t hash = hash_bytes(store->bin.strings + str.off, str.len);
+    store->hashes[k] = hash;
+    uint32_t idx;
+    if (store_find(store, hash, store->bin.strings + str.off, str.len, &idx))
+      continue;
+    size_t i = hash & (store->cap - 1);
+    while (store->index[i] != 0)
+      i = (i + 1) & (store->cap - 1);
+    store->index[i] = k + 1;
+  }
+  return true;
+
+fail:
+  au_store_close(store);
+  return false;
+}
+
+void au_store_close(au_store_t *store)
+{
+  if (store->data != NULL)
+    munmap(store->data, store->size);
+  free(store->index);
+  free(store->hashes);
+  memset(store, 0, sizeof(au_store_t));
+}
@@ -0,0 +1,1308 @@
+#include "auparser.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <strings.h>
+
+// Patterns are compiled to a program for a pike vm (thompson nfa simulation),
+// so matching is linear in the path length and never backtracks.
+//
+// Jump targets are relative to the instruction, so a compiled atom can be
+// moved or copied around as a whole, which is what quantifiers need.
+
+typedef enum {
+  OP_CHAR,   /// match byte c
+  OP_ANY,    /// match any byte
+  OP_SET,    /// match byte from sets[x]
+  OP_SPLIT,  /// fork to pc+x and pc+y, x has priority
+  OP_JMP,    /// jump to pc+x
+  OP_MATCH,  /// accept, x is the match id
+} op_t;
+
+typedef struct {
+  uint8_t op;
+  uint8_t c;
+  int32_t x;
+  int32_t y;
+} inst_t;
+
+/// Max length of the literal suffix kept for an entry
+#define SUFFIX_MAX (14)
+
+typedef struct {
+  uint32_t pc;    /// first instruction
+  bool tail;      /// pattern has no '/', match against the tail only
+  bool icase;     /// ignore case
+  uint8_t suflen; /// suffix length
+  char suffix[SUFFIX_MAX]; /// literal every match has to end with
+  uint32_t lit;   /// required literal offset in lits, lowercase
+  uint32_t litlen; /// required literal length, 0 if there is none
+} entry_t;
+
+struct au_prog {
+  inst_t *code;
+  size_t size;
+  size_t cap;
+  uint64_t (*sets)[4];
+  size_t nsets;
+  size_t setcap;
+  entry_t *entries;
+  size_t nentries;
+  size_t entcap;
+  char *lits;
+  size_t litsize;
+  size_t litcap;
+};
+
+/// Max number of instructions in a program
+#define PROG_MAX (1 << 20)
+/// Max count in \{n,m}
+#define COUNT_MAX (255)
+
+#define ERROR(msg) \
+  do { \
+    ctx->error = (msg); \
+    return false; \
+  } while (0)
+
+
+static bool emit(au_ctx_t *ctx, au_prog_t *p, inst_t inst)
+{
+  if (p->size >= p->cap) {
+    if (p->cap >= PROG_MAX)
+      ERROR("pattern too large");
+    size_t ncap = p->cap ? p->cap * 2 : 64;
+    inst_t *ncode = realloc(p->code, ncap * sizeof(inst_t));
+    if (ncode == NULL)
+      ERROR("realloc");
+    p->code = ncode;
+    p->cap = ncap;
+  }
+  p->code[p->size++] = inst;
+  return true;
+}
+
+/// Insert n instructions at position pos
+static bool insert(au_ctx_t *ctx, au_prog_t *p, size_t pos, const inst_t *insts, size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+    if (!emit(ctx, p, insts[i]))
+      return false;
+  memmove(p->code + pos + n, p->code + pos, (p->size - n - pos) * sizeof(inst_t));
+  memcpy(p->code + pos, insts, n * sizeof(inst_t));
+  return true;
+}
+
+static bool emit_set(au_ctx_t *ctx, au_prog_t *p, const uint64_t set[4])
+{
+  if (p->nsets >= p->setcap) {
+    size_t ncap = p->setcap ? p->setcap * 2 : 16;
+    uint64_t (*nsets)[4] = realloc(p->sets, ncap * sizeof(*nsets));
+    if (nsets == NULL)
+      ERROR("realloc");
+    p->sets = nsets;
+    p->setcap = ncap;
+  }
+  memcpy(p->sets[p->nsets], set, sizeof(p->sets[0]));
+  return emit(ctx, p, (inst_t){ .op = OP_SET, .x = p->nsets++ });
+}
+
+static bool add_entry(au_ctx_t *ctx, au_prog_t *p, entry_t e)
+{
+  if (p->nentries >= p->entcap) {
+    size_t ncap = p->entcap ? p->entcap * 2 : 4;
+    entry_t *nentries = realloc(p->entries, ncap * sizeof(entry_t));
+    if (nentries == NULL)
+      ERROR("realloc");
+    p->entries = nentries;
+    p->entcap = ncap;
+  }
+  p->entries[p->nentries++] = e;
+  return true;
+}
+
+
+#define SET_ADD(set, c) ((set)[(uint8_t)(c) >> 6] |= (uint64_t)1 << ((uint8_t)(c) & 63))
+#define SET_HAS(set, c) (((set)[(uint8_t)(c) >> 6] >> ((uint8_t)(c) & 63)) & 1)
+
+static void set_range(uint64_t set[4], int from, int to)
+{
+  for (int c = from; c <= to; ++c)
+    SET_ADD(set, c);
+}
+
+static void set_fold(uint64_t set[4])
+{
+  for (int c = 'a'; c <= 'z'; ++c) {
+    if (SET_HAS(set, c) || SET_HAS(set, toupper(c))) {
+      SET_ADD(set, c);
+      SET_ADD(set, toupper(c));
+    }
+  }
+}
+
+static void set_negate(uint64_t set[4])
+{
+  for (int i = 0; i < 4; ++i)
+    set[i] = ~set[i];
+  // like in vim, negated classes don't match end of line
+  set[0] &= ~((uint64_t)1 << '\n');
+}
+
+/// Fill set with vim character class, eg. the d in \d
+static bool class_set(au_ctx_t *ctx, uint64_t set[4], char cls)
+{
+  bool neg = isupper((unsigned char)cls);
+  switch (tolower((unsigned char)cls)) {
+    case 'i': // identifier
+    case 'k': // keyword
+      set_range(set, 'a', 'z');
+      set_range(set, 'A', 'Z');
+      set_range(set, 0x80, 0xFF);
+      SET_ADD(set, '_');
+      if (!neg)
+        set_range(set, '0', '9');
+      return true;
+    case 'f': // file name
+      set_range(set, 'a', 'z');
+      set_range(set, 'A', 'Z');
+      set_range(set, 0x80, 0xFF);
+      for (const char *c = "/.-_+,#$%~="; *c; ++c)
+        SET_ADD(set, *c);
+      if (!neg)
+        set_range(set, '0', '9');
+      return true;
+    case 'p': // printable
+      set_range(set, ' ', '~');
+      set_range(set, 0x80, 0xFF);
+      if (neg) {
+        for (int c = '0'; c <= '9'; ++c)
+          set[c >> 6] &= ~((uint64_t)1 << (c & 63));
+      }
+      return true;
+    case 's': SET_ADD(set, ' '); SET_ADD(set, '\t'); break;
+    case 'd': set_range(set, '0', '9'); break;
+    case 'x': set_range(set, '0', '9'); set_range(set, 'a', 'f'); set_range(set, 'A', 'F'); break;
+    case 'o': set_range(set, '0', '7'); break;
+    case 'w': set_range(set, '0', '9'); // fallthrough
+    case 'h': SET_ADD(set, '_'); // fallthrough
+    case 'a': set_range(set, 'a', 'z'); set_range(set, 'A', 'Z'); break;
+    case 'l': set_range(set, 'a', 'z'); break;
+    case 'u': set_range(set, 'A', 'Z'); break;
+    default:
+      ERROR("unknown character class");
+  }
+  if (neg)
+    set_negate(set);
+  return true;
+}
+
+/// Fill set with named class from a collection, eg. the digit in [[:digit:]]
+static bool named_set(au_ctx_t *ctx, uint64_t set[4], const char *name, size_t len)
+{
+#define IS(NAME) (len == sizeof(NAME) - 1 && memcmp(name, NAME, len) == 0)
+  if (IS("ident") || IS("keyword"))
+    return class_set(ctx, set, 'i');
+  if (IS("fname"))
+    return class_set(ctx, set, 'f');
+
+  bool found = false;
+  for (int i = 0; i < 256; ++i) {
+    unsigned char c = i;
+    if ((IS("alnum") && isalnum(c))
+        || (IS("alpha") && isalpha(c))
+        || (IS("blank") && (c == ' ' || c == '\t'))
+        || (IS("cntrl") && iscntrl(c))
+        || (IS("digit") && isdigit(c))
+        || (IS("graph") && isgraph(c))
+        || (IS("lower") && islower(c))
+        || (IS("print") && isprint(c))
+        || (IS("punct") && ispunct(c))
+        || (IS("space") && isspace(c))
+        || (IS("upper") && isupper(c))
+        || (IS("xdigit") && isxdigit(c))
+        || (IS("return") && c == '\r')
+        || (IS("tab") && c == '\t')
+        || (IS("escape") && c == '\033')
+        || (IS("backspace") && c == '\b')) {
+      SET_ADD(set, c);
+      found = true;
+    }
+  }
+#undef IS
+  if (!found)
+    ERROR("unknown character class");
+  return true;
+}
+
+/// Parse character set token, eg. [^a-z[:digit:]]
+static bool parse_set(au_ctx_t *ctx, uint64_t set[4], const token_t *tok)
+{
+  const char *it = tok->beg + 1;
+  const char *end = tok->beg + tok->len - 1; // closing ]
+  bool neg = false;
+  int prev = -1; // previous character, for ranges
+
+  if (it < end && *it == '^') {
+    neg = true;
+    ++it;
+  }
+
+  while (it < end) {
+    if (*it == '[') {
+      const char *name = it + 1;
+      if (*name != ':')
+        ERROR("unknown character class");
+      const char *close = memchr(name, ']', end - name);
+      if (close == NULL || close - name < 2 || close[-1] != ':')
+        ERROR("unknown character class");
+      if (!named_set(ctx, set, name + 1, close - name - 2))
+        return false;
+      it = close + 1;
+      prev = -1;
+    } else if (*it == '-' && prev >= 0 && it + 1 < end && it[1] != '[') {
+      set_range(set, prev, (uint8_t)it[1]);
+      it += 2;
+      prev = -1;
+    } else {
+      prev = (uint8_t)*it++;
+      SET_ADD(set, prev);
+    }
+  }
+
+  if (neg)
+    set_negate(set);
+  return true;
+}
+
+
+typedef struct {
+  au_ctx_t *ctx;
+  au_prog_t *p;
+  bool icase;
+} compiler_t;
+
+static bool compile_alt(compiler_t *cc, const token_t **pit);
+
+static bool emit_char(compiler_t *cc, char c)
+{
+  au_ctx_t *ctx = cc->ctx;
+  if (cc->icase && isalpha((unsigned char)c)) {
+    uint64_t set[4] = {0};
+    SET_ADD(set, tolower((unsigned char)c));
+    SET_ADD(set, toupper((unsigned char)c));
+    return emit_set(ctx, cc->p, set);
+  }
+  return emit(ctx, cc->p, (inst_t){ .op = OP_CHAR, .c = c });
+}
+
+/// Parse the N and M out of \\\{N,M\}. max is -1 when unbounded
+static bool parse_count(au_ctx_t *ctx, const token_t *tok, int *min, int *max)
+{
+  const char *it = tok->beg + 4; // skip \\\{
+  const char *end = tok->beg + tok->len - 2; // \}
+  if (it < end && *it == '-') // non-greedy doesn't matter here
+    ++it;
+
+  int n = -1, m = -1;
+  for (; it < end && isdigit((unsigned char)*it); ++it)
+    n = (n < 0 ? 0 : n * 10) + (*it - '0');
+  if (it < end && *it == ',') {
+    for (++it; it < end && isdigit((unsigned char)*it); ++it)
+      m = (m < 0 ? 0 : m * 10) + (*it - '0');
+    *min = n < 0 ? 0 : n;
+    *max = m;
+  } else {
+    // \{} is the same as *, \{n} is exactly n
+    *min = n < 0 ? 0 : n;
+    *max = n;
+  }
+  if (*min > COUNT_MAX || *max > COUNT_MAX)
+    ERROR("count too large");
+  if (*max >= 0 && *max < *min)
+    ERROR("invalid count range");
+  return true;
+}
+
+/// Apply quantifier token to the atom starting at beg
+static bool quantify(compiler_t *cc, size_t beg, const token_t *tok)
+{
+  au_ctx_t *ctx = cc->ctx;
+  au_prog_t *p = cc->p;
+  int32_t len = p->size - beg;
+  int min = 0, max = -1;
+
+  switch (tok->type) {
+    case ZeroOrMore: min = 0; max = -1; break;
+    case OneOrMore:  min = 1; max = -1; break;
+    case ZeroOrOne:  min = 0; max = 1; break;
+    case Count:
+      if (!parse_count(ctx, tok, &min, &max))
+        return false;
+      break;
+    default:
+      ERROR("not a quantifier");
+  }
+
+  if (min == 1 && max == 1)
+    return true;
+
+  inst_t *atom = malloc(len * sizeof(inst_t));
+  if (atom == NULL)
+    ERROR("malloc");
+  memcpy(atom, p->code + beg, len * sizeof(inst_t));
+  p->size = beg;
+
+  bool ok = true;
+  // required copies
+  for (int i = 0; ok && i < min; ++i)
+    for (int32_t j = 0; ok && j < len; ++j)
+      ok = emit(ctx, p, atom[j]);
+  if (max < 0) {
+    // loop: split over the atom, jump back to the split
+    size_t loop = p->size;
+    ok = ok && emit(ctx, p, (inst_t){ .op = OP_SPLIT, .x = 1, .y = len + 2 });
+    for (int32_t j = 0; ok && j < len; ++j)
+      ok = emit(ctx, p, atom[j]);
+    ok = ok && emit(ctx, p, (inst_t){ .op = OP_JMP, .x = -(int32_t)(p->size - loop) });
+  } else {
+    // optional copies
+    for (int i = min; ok && i < max; ++i) {
+      ok = emit(ctx, p, (inst_t){ .op = OP_SPLIT, .x = 1, .y = len + 1 });
+      for (int32_t j = 0; ok && j < len; ++j)
+        ok = emit(ctx, p, atom[j]);
+    }
+  }
+
+  free(atom);
+  return ok;
+}
+
+/// Compile tokens up to the next branch, pop or end
+static bool compile_seq(compiler_t *cc, const token_t **pit)
+{
+  au_ctx_t *ctx = cc->ctx;
+  au_prog_t *p = cc->p;
+  const token_t *it = *pit;
+  long atom = -1; // start of last atom, for quantifiers
+
+  for (; it->type && it->type != Branch && it->type != Pop; ++it) {
+    switch (it->type) {
+      case Literal:
+        for (size_t i = 0; i < it->len; ++i) {
+          if (it->beg[i] == '\\' && i + 1 < it->len)
+            ++i;
+          atom = p->size;
+          if (!emit_char(cc, it->beg[i]))
+            return false;
+        }
+        break;
+      case AnyChar:
+        atom = p->size;
+        if (!emit(ctx, p, (inst_t){ .op = OP_ANY }))
+          return false;
+        break;
+      case AnyChars:
+        atom = -1;
+        if (!emit(ctx, p, (inst_t){ .op = OP_SPLIT, .x = 1, .y = 3 })
+            || !emit(ctx, p, (inst_t){ .op = OP_ANY })
+            || !emit(ctx, p, (inst_t){ .op = OP_JMP, .x = -2 }))
+          return false;
+        break;
+      case Set:
+      case Cls: {
+        uint64_t set[4] = {0};
+        if (it->type == Set && !parse_set(ctx, set, it))
+          return false;
+        if (it->type == Cls) {
+          if (!class_set(ctx, set, it->beg[it->len - 1]))
+            return false;
+          if (it->len == 3) // \_x also matches end of line
+            SET_ADD(set, '\n');
+        }
+        if (cc->icase)
+          set_fold(set);
+        atom = p->size;
+        if (!emit_set(ctx, p, set))
+          return false;
+        break;
+      }
+      case ZeroOrMore:
+      case OneOrMore:
+      case ZeroOrOne:
+      case Count:
+        if (atom < 0)
+          ERROR("nothing to repeat");
+        if (!quantify(cc, atom, it))
+          return false;
+        atom = -1;
+        break;
+      case Push:
+        atom = p->size;
+        ++it;
+        if (!compile_alt(cc, &it))
+          return false;
+        if (it->type != Pop)
+          ERROR("unclosed branch");
+        break;
+      case Opts:
+      case Empty:
+        break;
+      default:
+        ERROR("unexpected token");
+    }
+  }
+
+  *pit = it;
+  return true;
+}
+
+/// Compile alternatives inside of a group, up to the closing pop
+static bool compile_alt(compiler_t *cc, const token_t **pit)
+{
+  au_ctx_t *ctx = cc->ctx;
+  au_prog_t *p = cc->p;
+  size_t *jmps = NULL;
+  size_t njmps = 0;
+  bool ok = true;
+
+  for (;;) {
+    size_t beg = p->size;
+    if (!(ok = compile_seq(cc, pit)))
+      break;
+    if ((*pit)->type != Branch)
+      break;
+    ++*pit;
+
+    // split before this alternative, jump to the end after it
+    size_t *njmp = realloc(jmps, (njmps + 1) * sizeof(size_t));
+    if (njmp == NULL) {
+      ctx->error = "realloc";
+      ok = false;
+      break;
+    }
+    jmps = njmp;
+    int32_t len = p->size - beg;
+    if (!(ok = insert(ctx, p, beg, &(inst_t){ .op = OP_SPLIT, .x = 1, .y = len + 2 }, 1)))
+      break;
+    jmps[njmps++] = p->size;
+    if (!(ok = emit(ctx, p, (inst_t){ .op = OP_JMP })))
+      break;
+  }
+
+  for (size_t i = 0; ok && i < njmps; ++i)
+    p->code[jmps[i]].x = p->size - jmps[i];
+  free(jmps);
+  return ok;
+}
+
+/// Find literal suffix of the branch. Every path matching the branch ends
+/// with it, so it can be checked before running the program.
+static void find_suffix(entry_t *e, const token_t *beg, const token_t *end)
+{
+  const token_t *last = end;
+  while (last > beg && (last[-1].type == Opts || last[-1].type == Empty))
+    --last;
+  if (last == beg || last[-1].type != Literal)
+    return;
+  --last;
+
+  // unescape, keeping the last SUFFIX_MAX characters
+  char buf[SUFFIX_MAX];
+  size_t n = 0;
+  for (size_t i = 0; i < last->len; ++i) {
+    if (last->beg[i] == '\\' && i + 1 < last->len)
+      ++i;
+    if (n == SUFFIX_MAX) {
+      memmove(buf, buf + 1, SUFFIX_MAX - 1);
+      --n;
+    }
+    buf[n++] = last->beg[i];
+  }
+  memcpy(e->suffix, buf, n);
+  e->suflen = n;
+}
+
+/// Find the longest literal every path matching the branch has to contain.
+/// Only literals outside of groups are required, and a quantifier makes the
+/// last character of a literal optional.
+static bool find_literal(au_ctx_t *ctx, au_prog_t *p, entry_t *e, const token_t *beg, const token_t *end)
+{
+  const token_t *best = NULL;
+  size_t bestlen = 0;
+  for (const token_t *it = beg; it < end; ++it) {
+    if (it->type != Literal || it->lvl != 0)
+      continue;
+    size_t len = 0;
+    for (size_t i = 0; i < it->len; ++i, ++len)
+      if (it->beg[i] == '\\' && i + 1 < it->len)
+        ++i;
+    if (it + 1 < end && it[1].type != OneOrMore
+        && (it[1].type == ZeroOrMore || it[1].type == ZeroOrOne || it[1].type == Count))
+      --len;
+    if (len > bestlen) {
+      best = it;
+      bestlen = len;
+    }
+  }
+  if (best == NULL)
+    return true;
+
+  if (p->litsize + bestlen > p->litcap) {
+    size_t ncap = p->litcap ? p->litcap * 2 : 256;
+    while (ncap < p->litsize + bestlen)
+      ncap *= 2;
+    char *nlits = realloc(p->lits, ncap);
+    if (nlits == NULL)
+      ERROR("realloc");
+    p->lits = nlits;
+    p->litcap = ncap;
+  }
+
+  e->lit = p->litsize;
+  e->litlen = bestlen;
+  for (size_t i = 0, n = 0; n < bestlen; ++i, ++n) {
+    if (best->beg[i] == '\\' && i + 1 < best->len)
+      ++i;
+    p->lits[p->litsize++] = tolower((unsigned char)best->beg[i]);
+  }
+  return true;
+}
+
+/// Compile pattern into program p. Every root level branch gets its own
+/// entry, since in autocmds a comma separates independent patterns.
+static bool compile(au_ctx_t *ctx, au_prog_t *p, const token_t *toks, int32_t id)
+{
+  const token_t *it = toks;
+
+  for (;;) {
+    const token_t *beg = it;
+    bool empty = true;
+    bool slash = false;
+    bool icase = false;
+    for (; it->type && !(it->type == Branch && it->lvl == 0); ++it) {
+      if (it->type != Empty)
+        empty = false;
+      if (it->type == Opts && it->beg[1] == 'c')
+        icase = true;
+      if (memchr(it->beg, '/', it->len))
+        slash = true;
+    }
+
+    // ignore empty branches on root level, same as unroll
+    if (!empty) {
+      compiler_t cc = { .ctx = ctx, .p = p, .icase = icase };
+      entry_t e = { .pc = p->size, .tail = !slash, .icase = icase };
+      find_suffix(&e, beg, it);
+      if (!find_literal(ctx, p, &e, beg, it))
+        return false;
+      const token_t *cit = beg;
+      if (!compile_seq(&cc, &cit))
+        return false;
+      if (cit != it)
+        ERROR("unexpected branch close");
+      if (!emit(ctx, p, (inst_t){ .op = OP_MATCH, .x = id }) || !add_entry(ctx, p, e))
+        return false;
+    }
+
+    if (!it->type)
+      break;
+    ++it;
+  }
+
+  return true;
+}
+
+
+au_prog_t *au_compile(au_ctx_t *ctx, const token_t *toks)
+{
+  au_prog_t *p = calloc(1, sizeof(au_prog_t));
+  if (p == NULL) {
+    ctx->error = "malloc";
+    return NULL;
+  }
+  if (!compile(ctx, p, toks, 0)) {
+    au_free_prog(p);
+    return NULL;
+  }
+  return p;
+}
+
+void au_free_prog(au_prog_t *p)
+{
+  if (p == NULL)
+    return;
+  free(p->code);
+  free(p->sets);
+  free(p->entries);
+  free(p->lits);
+  free(p);
+}
+
+
+// Threads are pairs of (pc, mode) encoded as pc * 2 + mode. Tail mode threads
+// were started after a '/' and can't consume another one, so they can only
+// match against the tail of the path.
+#define MODE_FULL (0)
+#define MODE_TAIL (1)
+
+typedef struct {
+  uint32_t *list;
+  size_t size;
+  uint64_t *on; // bitmap of states on the list
+} tlist_t;
+
+typedef struct {
+  const au_prog_t *p;
+  tlist_t cur;
+  tlist_t next;
+  uint32_t *stack;
+  const entry_t **entries; // entries that can still match
+  size_t nentries;
+} vm_t;
+
+/// Add state and its epsilon closure to the thread list
+static void addthread(vm_t *vm, tlist_t *l, uint32_t state)
+{
+  const inst_t *code = vm->p->code;
+  size_t sp = 0;
+  vm->stack[sp++] = state;
+  while (sp > 0) {
+    uint32_t s = vm->stack[--sp];
+    if ((l->on[s >> 6] >> (s & 63)) & 1)
+      continue;
+    l->on[s >> 6] |= (uint64_t)1 << (s & 63);
+    const inst_t *in = &code[s >> 1];
+    if (in->op == OP_JMP) {
+      vm->stack[sp++] = s + in->x * 2;
+    } else if (in->op == OP_SPLIT) {
+      vm->stack[sp++] = s + in->y * 2;
+      vm->stack[sp++] = s + in->x * 2;
+    } else {
+      l->list[l->size++] = s;
+    }
+  }
+}
+
+/// Start entries at the beginning of the path, or only the tail entries again
+/// after a '/'
+static void addentries(vm_t *vm, tlist_t *l, bool restart)
+{
+  for (size_t i = 0; i < vm->nentries; ++i) {
+    if (vm->entries[i]->tail)
+      addthread(vm, l, vm->entries[i]->pc * 2 + MODE_TAIL);
+    else if (!restart)
+      addthread(vm, l, vm->entries[i]->pc * 2 + MODE_FULL);
+  }
+}
+
+static bool suffix_ok(const entry_t *e, const char *str, size_t len)
+{
+  if (e->suflen > len)
+    return false;
+  const char *tail = str + len - e->suflen;
+  return !(e->icase ? strncasecmp(tail, e->suffix, e->suflen) : memcmp(tail, e->suffix, e->suflen));
+}
+
+/// Run program on string
+/// @param[in]  entries   entries to start from
+/// @return     lowest match id, or -1 if nothing matched
+static int32_t run(const au_prog_t *p, const entry_t **entries, size_t nentries,
+    const char *str, size_t len)
+{
+  int32_t id = -1;
+  size_t nstates = p->size * 2;
+  size_t nwords = (nstates + 63) / 64;
+  // two bitmaps, two thread lists and the closure stack
+  size_t need = nwords * 2 + (nstates * 4 + 2 + 1) / 2;
+
+  // small programs don't need to go through malloc
+  uint64_t local[512];
+  uint64_t *mem = need <= sizeof(local) / sizeof(uint64_t) ? local : malloc(need * sizeof(uint64_t));
+  if (mem == NULL)
+    return -1;
+
+  uint32_t *lists = (uint32_t *)(mem + nwords * 2);
+  vm_t vm = {
+    .p = p,
+    .cur = { .list = lists, .on = mem },
+    .next = { .list = lists + nstates, .on = mem + nwords },
+    .stack = lists + nstates * 2,
+    .entries = entries,
+    .nentries = nentries,
+  };
+  memset(vm.cur.on, 0, nwords * sizeof(uint64_t));
+
+  addentries(&vm, &vm.cur, false);
+
+  for (size_t i = 0; i < len; ++i) {
+    if (vm.cur.size == 0) {
+      // nothing to do until tail threads start again after the next '/'
+      const char *slash = memchr(str + i, '/', len - i);
+      if (slash == NULL)
+        break;
+      i = slash - str;
+    }
+    uint8_t c = str[i];
+    vm.next.size = 0;
+    memset(vm.next.on, 0, nwords * sizeof(uint64_t));
+
+    for (size_t j = 0; j < vm.cur.size; ++j) {
+      uint32_t s = vm.cur.list[j];
+      const inst_t *in = &p->code[s >> 1];
+      if ((s & 1) == MODE_TAIL && c == '/')
+        continue;
+      bool ok;
+      switch (in->op) {
+        case OP_CHAR: ok = in->c == c; break;
+        case OP_ANY:  ok = true; break;
+        case OP_SET:  ok = SET_HAS(p->sets[in->x], c); break;
+        default:      ok = false; break;
+      }
+      if (ok)
+        addthread(&vm, &vm.next, s + 2);
+    }
+    if (c == '/')
+      addentries(&vm, &vm.next, true);
+
+    tlist_t tmp = vm.cur;
+    vm.cur = vm.next;
+    vm.next = tmp;
+  }
+
+  for (size_t j = 0; j < vm.cur.size; ++j) {
+    const inst_t *in = &p->code[vm.cur.list[j] >> 1];
+    if (in->op == OP_MATCH && (id < 0 || in->x < id))
+      id = in->x;
+  }
+
+  if (mem != local)
+    free(mem);
+  return id;
+}
+
+bool au_match(const au_prog_t *p, const char *path, size_t len)
+{
+  // skip entries that can't match because of their suffix
+  const entry_t *ebuf[16];
+  const entry_t **entries = p->nentries <= 16 ? ebuf : malloc(p->nentries * sizeof(entry_t *));
+  if (entries == NULL)
+    return false;
+  size_t nentries = 0;
+  for (size_t i = 0; i < p->nentries; ++i)
+    if (suffix_ok(&p->entries[i], path, len))
+      entries[nentries++] = &p->entries[i];
+
+  bool res = nentries > 0 && run(p, entries, nentries, path, len) >= 0;
+  if (entries != ebuf)
+    free(entries);
+  return res;
+}
+
+
+// Literal prefilter. Most entries require some literal to be in the path, eg.
+// ".json" in "*.json". An aho-corasick automaton over all of these literals
+// finds the entries that can match in one scan, and only those are run.
+// Literals and paths are compared in lowercase, which is still a necessary
+// condition for case sensitive entries.
+
+typedef struct {
+  uint32_t entry;   /// entry index
+  uint32_t next;    /// next output for the same node, 0 terminated
+} output_t;
+
+typedef struct {
+  uint8_t cls[256];   /// byte to class, for smaller transition tables
+  size_t nclasses;
+  uint32_t *delta;    /// transitions, nnodes * nclasses
+  uint32_t *out;      /// first output of the node, index + 1
+  uint32_t *dict;     /// closest node on the fail chain with outputs, 0 if none
+  size_t nnodes;
+  output_t *outs;
+  size_t nouts;
+  uint32_t *always;   /// entries without a required literal
+  size_t nalways;
+  size_t nentries;
+} filter_t;
+
+static void filter_free(filter_t *f)
+{
+  if (f == NULL)
+    return;
+  free(f->delta);
+  free(f->out);
+  free(f->dict);
+  free(f->outs);
+  free(f->always);
+  free(f);
+}
+
+static filter_t *filter_build(const au_prog_t *p)
+{
+  filter_t *f = calloc(1, sizeof(filter_t));
+  uint32_t *fail = NULL;
+  uint32_t *queue = NULL;
+  if (f == NULL)
+    goto fail;
+
+  // byte classes, class 0 is for bytes that aren't in any literal
+  f->nclasses = 1;
+  for (size_t i = 0; i < p->litsize; ++i) {
+    uint8_t c = p->lits[i];
+    if (f->cls[c] == 0) {
+      if (f->nclasses == 256)
+        continue;
+      f->cls[c] = f->nclasses++;
+    }
+  }
+  for (int c = 'A'; c <= 'Z'; ++c)
+    f->cls[c] = f->cls[tolower(c)];
+
+  // every literal character can add a node
+  size_t maxnodes = p->litsize + 1;
+  f->delta = malloc(maxnodes * f->nclasses * sizeof(uint32_t));
+  f->out = calloc(maxnodes, sizeof(uint32_t));
+  f->dict = calloc(maxnodes, sizeof(uint32_t));
+  f->outs = malloc(p->nentries * sizeof(output_t));
+  f->always = malloc(p->nentries * sizeof(uint32_t));
+  fail = calloc(maxnodes, sizeof(uint32_t));
+  queue = malloc(maxnodes * sizeof(uint32_t));
+  if (!f->delta || !f->out || !f->dict || !f->outs || !f->always || !fail || !queue)
+    goto fail;
+  memset(f->delta, 0xFF, maxnodes * f->nclasses * sizeof(uint32_t));
+  f->nnodes = 1;
+  f->nentries = p->nentries;
+
+  // trie
+  for (size_t i = 0; i < p->nentries; ++i) {
+    const entry_t *e = &p->entries[i];
+    if (e->litlen == 0) {
+      f->always[f->nalways++] = i;
+      continue;
+    }
+    uint32_t node = 0;
+    for (size_t j = 0; j < e->litlen; ++j) {
+      uint32_t *next = &f->delta[node * f->nclasses + f->cls[(uint8_t)p->lits[e->lit + j]]];
+      if (*next == UINT32_MAX)
+        *next = f->nnodes++;
+      node = *next;
+    }
+    f->outs[f->nouts] = (output_t){ .entry = i, .next = f->out[node] };
+    f->out[node] = ++f->nouts;
+  }
+
+  // fail links, breadth first. missing transitions are filled in from the
+  // fail node, which turns the trie into a dfa
+  size_t qbeg = 0, qend = 0;
+  for (size_t c = 0; c < f->nclasses; ++c) {
+    uint32_t *next = &f->delta[c];
+    if (*next == UINT32_MAX) {
+      *next = 0;
+    } else {
+      fail[*next] = 0;
+      queue[qend++] = *next;
+    }
+  }
+  while (qbeg < qend) {
+    uint32_t node = queue[qbeg++];
+    for (size_t c = 0; c < f->nclasses; ++c) {
+      uint32_t *next = &f->delta[node * f->nclasses + c];
+      uint32_t fnext = f->delta[fail[node] * f->nclasses + c];
+      if (*next == UINT32_MAX) {
+        *next = fnext;
+      } else {
+        fail[*next] = fnext;
+        f->dict[*next] = f->out[fnext] ? fnext : f->dict[fnext];
+        queue[qend++] = *next;
+      }
+    }
+  }
+
+  free(fail);
+  free(queue);
+  return f;
+
+fail:
+  free(fail);
+  free(queue);
+  filter_free(f);
+  return NULL;
+}
+
+/// Find entries that can match the path
+/// @param[out] res   entry indexes, without duplicates
+/// @param[out] seen  bitmap of entries, cleared by the caller
+/// @return     number of entries
+static size_t filter_scan(const filter_t *f, const char *str, size_t len,
+    uint32_t *res, uint64_t *seen)
+{
+  size_t n = 0;
+  for (size_t i = 0; i < f->nalways; ++i)
+    res[n++] = f->always[i];
+
+  uint32_t node = 0;
+  for (size_t i = 0; i < len; ++i) {
+    node = f->delta[node * f->nclasses + f->cls[(uint8_t)str[i]]];
+    for (uint32_t m = f->out[node] ? node : f->dict[node]; m != 0; m = f->dict[m]) {
+      for (uint32_t o = f->out[m]; o != 0; o = f->outs[o - 1].next) {
+        uint32_t e = f->outs[o - 1].entry;
+        if ((seen[e >> 6] >> (e & 63)) & 1)
+          continue;
+        seen[e >> 6] |= (uint64_t)1 << (e & 63);
+        res[n++] = e;
+      }
+    }
+  }
+  return n;
+}
+
+
+// Pattern sets are matched with a lazily built dfa. Each dfa state is a set of
+// nfa states of the combined program, and transitions are computed the first
+// time they're taken. Since the program is shared, a lookup is a single pass
+// over the path no matter how many patterns are in the set.
+
+/// Max number of cached dfa states, the cache is flushed when it's full
+#define DFA_MAX (4096)
+/// Transition not computed yet
+#define DFA_UNKNOWN UINT32_MAX
+
+typedef struct {
+  uint32_t next[256]; /// transitions
+  size_t beg;         /// nfa states offset in the pool
+  size_t size;        /// number of nfa states
+  int32_t match;      /// lowest match id, -1 if not accepting
+} dstate_t;
+
+struct au_set {
+  au_prog_t prog;
+  au_rule_t *rules;
+  size_t nrules;
+  size_t rulecap;
+
+  dstate_t *states;   /// dfa states
+  size_t nstates;
+  size_t statecap;
+  uint32_t *pool;     /// nfa states for every dfa state
+  size_t poolsize;
+  size_t poolcap;
+  uint32_t *table;    /// hash table of dfa states, stores index + 1
+  size_t tablecap;
+  uint32_t start;     /// start state, DFA_UNKNOWN when cache is empty
+  size_t flushes;     /// number of times the cache was flushed
+
+  uint64_t *scratch;  /// memory for the vm, sized for the program
+  size_t scratchcap;
+
+  filter_t *filter;   /// literal prefilter, NULL when it has to be rebuilt
+};
+
+au_set_t *au_set_new(void)
+{
+  au_set_t *set = calloc(1, sizeof(au_set_t));
+  if (set == NULL)
+    return NULL;
+  set->start = DFA_UNKNOWN;
+  return set;
+}
+
+static void dfa_clear(au_set_t *set)
+{
+  set->nstates = 0;
+  set->poolsize = 0;
+  set->start = DFA_UNKNOWN;
+  if (set->table != NULL)
+    memset(set->table, 0, set->tablecap * sizeof(uint32_t));
+}
+
+void au_set_free(au_set_t *set)
+{
+  if (set == NULL)
+    return;
+  for (size_t i = 0; i < set->nrules; ++i)
+    free((char *)set->rules[i].cmd);
+  free(set->rules);
+  free(set->prog.code);
+  free(set->prog.sets);
+  free(set->prog.entries);
+  free(set->prog.lits);
+  filter_free(set->filter);
+  free(set->states);
+  free(set->pool);
+  free(set->table);
+  free(set->scratch);
+  free(set);
+}
+
+bool au_set_add(au_ctx_t *ctx, au_set_t *set, const token_t *toks, size_t lnum, const char *cmd)
+{
+  au_prog_t *p = &set->prog;
+  if (set->nrules >= set->rulecap) {
+    size_t ncap = set->rulecap ? set->rulecap * 2 : 64;
+    au_rule_t *nrules = realloc(set->rules, ncap * sizeof(au_rule_t));
+    if (nrules == NULL)
+      ERROR("realloc");
+    set->rules = nrules;
+    set->rulecap = ncap;
+  }
+
+  char *cmdcopy = NULL;
+  if (cmd != NULL && (cmdcopy = strdup(cmd)) == NULL)
+    ERROR("malloc");
+
+  // roll back on errors, so the set stays usable
+  size_t size = p->size, nsets = p->nsets, nentries = p->nentries, litsize = p->litsize;
+  if (!compile(ctx, p, toks, set->nrules)) {
+    p->size = size;
+    p->nsets = nsets;
+    p->nentries = nentries;
+    p->litsize = litsize;
+    free(cmdcopy);
+    return false;
+  }
+
+  set->rules[set->nrules++] = (au_rule_t){ .lnum = lnum, .cmd = cmdcopy };
+  dfa_clear(set);
+  filter_free(set->filter);
+  set->filter = NULL;
+  return true;
+}
+
+size_t au_set_size(const au_set_t *set)
+{
+  return set->nrules;
+}
+
+static uint64_t hash_states(const uint32_t *states, size_t n)
+{
+  // fnv-1a
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < n; ++i) {
+    h ^= states[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+static bool table_grow(au_set_t *set)
+{
+  size_t ncap = set->tablecap ? set->tablecap * 2 : 256;
+  uint32_t *ntable = calloc(ncap, sizeof(uint32_t));
+  if (ntable == NULL)
+    return false;
+  for (size_t i = 0; i < set->nstates; ++i) {
+    const dstate_t *ds = &set->states[i];
+    size_t h = hash_states(set->pool + ds->beg, ds->size) & (ncap - 1);
+    while (ntable[h] != 0)
+      h = (h + 1) & (ncap - 1);
+    ntable[h] = i + 1;
+  }
+  free(set->table);
+  set->table = ntable;
+  set->tablecap = ncap;
+  return true;
+}
+
+/// Find dfa state for the sorted list of nfa states, add it if it's missing.
+/// Flushes the cache when it's full, which invalidates other state indexes.
+/// @return     state index, DFA_UNKNOWN when out of memory
+static uint32_t dfa_state(au_set_t *set, const uint32_t *states, size_t n)
+{
+  size_t h = hash_states(states, n);
+  if (set->table != NULL) {
+    for (size_t i = h & (set->tablecap - 1);; i = (i + 1) & (set->tablecap - 1)) {
+      uint32_t idx = set->table[i];
+      if (idx == 0)
+        break;
+      const dstate_t *ds = &set->states[idx - 1];
+      // the dead state is empty, and the pool may not be allocated yet
+      if (ds->size == n && (n == 0 || memcmp(set->pool + ds->beg, states, n * sizeof(uint32_t)) == 0))
+        return idx - 1;
+    }
+  }
+
+  if (set->nstates >= DFA_MAX) {
+    dfa_clear(set);
+    ++set->flushes;
+  }
+
+  if (set->nstates * 2 >= set->tablecap && !table_grow(set))
+    return DFA_UNKNOWN;
+  if (set->nstates >= set->statecap) {
+    size_t ncap = set->statecap ? set->statecap * 2 : 64;
+    dstate_t *nstates = realloc(set->states, ncap * sizeof(dstate_t));
+    if (nstates == NULL)
+      return DFA_UNKNOWN;
+    set->states = nstates;
+    set->statecap = ncap;
+  }
+  if (set->poolsize + n > set->poolcap) {
+    size_t ncap = set->poolcap ? set->poolcap * 2 : 1024;
+    while (ncap < set->poolsize + n)
+      ncap *= 2;
+    uint32_t *npool = realloc(set->pool, ncap * sizeof(uint32_t));
+    if (npool == NULL)
+      return DFA_UNKNOWN;
+    set->pool = npool;
+    set->poolcap = ncap;
+  }
+
+  uint32_t idx = set->nstates++;
+  dstate_t *ds = &set->states[idx];
+  ds->beg = set->poolsize;
+  ds->size = n;
+  ds->match = -1;
+  memset(ds->next, 0xFF, sizeof(ds->next));
+  if (n > 0)
+    memcpy(set->pool + set->poolsize, states, n * sizeof(uint32_t));
+  set->poolsize += n;
+  for (size_t i = 0; i < n; ++i) {
+    const inst_t *in = &set->prog.code[states[i] >> 1];
+    if (in->op == OP_MATCH && (ds->match < 0 || in->x < ds->match))
+      ds->match = in->x;
+  }
+
+  size_t i = h & (set->tablecap - 1);
+  while (set->table[i] != 0)
+    i = (i + 1) & (set->tablecap - 1);
+  set->table[i] = idx + 1;
+  return idx;
+}
+
+/// Prepare vm for computing dfa transitions
+static bool dfa_vm(au_set_t *set, vm_t *vm)
+{
+  const au_prog_t *p = &set->prog;
+  size_t nstates = p->size * 2;
+  size_t nwords = (nstates + 63) / 64;
+  size_t need = nwords * 2 + (nstates * 4 + 2 + 1) / 2;
+  if (need > set->scratchcap) {
+    uint64_t *nscratch = realloc(set->scratch, need * sizeof(uint64_t));
+    if (nscratch == NULL)
+      return false;
+    set->scratch = nscratch;
+    set->scratchcap = need;
+  }
+
+  uint32_t *lists = (uint32_t *)(set->scratch + nwords * 2);
+  *vm = (vm_t){
+    .p = p,
+    .cur = { .list = lists, .on = set->scratch },
+    .next = { .list = lists + nstates, .on = set->scratch + nwords },
+    .stack = lists + nstates * 2,
+  };
+  memset(set->scratch, 0, nwords * 2 * sizeof(uint64_t));
+  return true;
+}
+
+/// Collect nfa states from the bitmap in sorted order
+static size_t dfa_sorted(const vm_t *vm, const tlist_t *l)
+{
+  size_t nwords = (vm->p->size * 2 + 63) / 64;
+  size_t n = 0;
+  for (size_t w = 0; w < nwords; ++w) {
+    for (uint64_t bits = l->on[w]; bits; bits &= bits - 1)
+      l->list[n++] = w * 64 + __builtin_ctzll(bits);
+  }
+  return n;
+}
+
+static uint32_t dfa_start(au_set_t *set)
+{
+  vm_t vm;
+  if (!dfa_vm(set, &vm))
+    return DFA_UNKNOWN;
+  // every entry is active, prefiltering is left to the dfa itself
+  for (size_t i = 0; i < set->prog.nentries; ++i) {
+    const entry_t *e = &set->prog.entries[i];
+    addthread(&vm, &vm.cur, e->pc * 2 + (e->tail ? MODE_TAIL : MODE_FULL));
+  }
+  return set->start = dfa_state(set, vm.cur.list, dfa_sorted(&vm, &vm.cur));
+}
+
+/// Compute transition from state d on byte c
+static uint32_t dfa_step(au_set_t *set, uint32_t d, uint8_t c)
+{
+  const au_prog_t *p = &set->prog;
+  vm_t vm;
+  if (!dfa_vm(set, &vm))
+    return DFA_UNKNOWN;
+
+  const dstate_t *ds = &set->states[d];
+  for (size_t j = 0; j < ds->size; ++j) {
+    uint32_t s = set->pool[ds->beg + j];
+    const inst_t *in = &p->code[s >> 1];
+    if ((s & 1) == MODE_TAIL && c == '/')
+      continue;
+    bool ok;
+    switch (in->op) {
+      case OP_CHAR: ok = in->c == c; break;
+      case OP_ANY:  ok = true; break;
+      case OP_SET:  ok = SET_HAS(p->sets[in->x], c); break;
+      default:      ok = false; break;
+    }
+    if (ok)
+      addthread(&vm, &vm.next, s + 2);
+  }
+  if (c == '/') {
+    for (size_t i = 0; i < p->nentries; ++i)
+      if (p->entries[i].tail)
+        addthread(&vm, &vm.next, p->entries[i].pc * 2 + MODE_TAIL);
+  }
+
+  size_t flushes = set->flushes;
+  uint32_t nd = dfa_state(set, vm.next.list, dfa_sorted(&vm, &vm.next));
+  // cache could be flushed, in which case d is gone
+  if (nd != DFA_UNKNOWN && flushes == set->flushes)
+    set->states[d].next[c] = nd;
+  return nd;
+}
+
+const au_rule_t *au_set_match(au_set_t *set, const char *path, size_t len)
+{
+  uint32_t d = set->start;
+  if (d == DFA_UNKNOWN && (d = dfa_start(set)) == DFA_UNKNOWN)
+    return NULL;
+
+  for (size_t i = 0; i < len; ++i) {
+    uint8_t c = path[i];
+    uint32_t nd = set->states[d].next[c];
+    if (nd == DFA_UNKNOWN && (nd = dfa_step(set, d, c)) == DFA_UNKNOWN)
+      return NULL;
+    d = nd;
+  }
+
+  int32_t id = set->states[d].match;
+  return id < 0 ? NULL : &set->rules[id];
+}
+
+const au_rule_t *au_set_match_prefiltered(au_set_t *set, const char *path, size_t len)
+{
+  const au_prog_t *p = &set->prog;
+  if (set->filter == NULL && (set->filter = filter_build(p)) == NULL)
+    return NULL;
+
+  size_t nwords = (p->nentries + 63) / 64;
+  size_t ncandcap = (p->nentries + 1) & ~(size_t)1; // keep the bitmap aligned
+  uint32_t *cand = malloc(ncandcap * sizeof(uint32_t) + nwords * sizeof(uint64_t)
+      + p->nentries * sizeof(entry_t *));
+  if (cand == NULL)
+    return NULL;
+  uint64_t *seen = (uint64_t *)(cand + ncandcap);
+  const entry_t **entries = (const entry_t **)(seen + nwords);
+  memset(seen, 0, nwords * sizeof(uint64_t));
+
+  size_t ncand = filter_scan(set->filter, path, len, cand, seen);
+  size_t nentries = 0;
+  for (size_t i = 0; i < ncand; ++i)
+    if (suffix_ok(&p->entries[cand[i]], path, len))
+      entries[nentries++] = &p->entries[cand[i]];
+
+  int32_t id = nentries > 0 ? run(p, entries, nentries, path, len) : -1;
+  free(cand);
+  return id < 0 ? NULL : &set->rules[id];
+}
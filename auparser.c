@@ -3,9 +3,18 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <stdbool.h>
 #include <stdnoreturn.h>
+#include <stdint.h>
 #include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 const char *type_str(type_t type)
 {
@@ -32,18 +41,121 @@ const char *type_str(type_t type)
 }
 
 
-/// Error message
-const char *error = NULL;
+struct au_chunk {
+  struct au_chunk *next;
+  size_t size;
+  max_align_t data[];
+};
+
+#define ARENA_ALIGN (_Alignof(max_align_t))
+#define ARENA_CHUNK_SIZE (64 * 1024)
+
+static inline size_t arena_align(size_t size)
+{
+  return (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+void *au_arena_alloc(au_arena_t *arena, size_t size)
+{
+  size = arena_align(size);
+  if ((size_t)(arena->end - arena->ptr) < size) {
+    // chunks double in size, so there are only a few of them
+    size_t csize = arena->size > ARENA_CHUNK_SIZE ? arena->size : ARENA_CHUNK_SIZE;
+    if (csize < size)
+      csize = size;
+    struct au_chunk *chunk = malloc(sizeof(struct au_chunk) + csize);
+    if (chunk == NULL)
+      return NULL;
+    chunk->next = NULL;
+    chunk->size = csize;
+    arena->size += csize;
+    if (arena->cur != NULL)
+      arena->cur->next = chunk;
+    else
+      arena->head = chunk;
+    arena->cur = chunk;
+    arena->ptr = (char *)chunk->data;
+    arena->end = arena->ptr + chunk->size;
+  }
+  void *res = arena->ptr;
+  arena->ptr += size;
+  return res;
+}
+
+void *au_arena_realloc(au_arena_t *arena, void *ptr, size_t old, size_t size)
+{
+  if (ptr != NULL && (char *)ptr + arena_align(old) == arena->ptr
+      && (size_t)(arena->end - (char *)ptr) >= arena_align(size)) {
+    arena->ptr = (char *)ptr + arena_align(size);
+    return ptr;
+  }
+  void *res = au_arena_alloc(arena, size);
+  if (res != NULL && ptr != NULL)
+    memcpy(res, ptr, old < size ? old : size);
+  return res;
+}
+
+void au_arena_reset(au_arena_t *arena)
+{
+  if (arena->head != NULL && arena->head->next != NULL) {
+    // replace chunks with a single one big enough for all of them, so
+    // after the first few resets it's just resetting the pointer
+    size_t size = arena->size;
+    au_arena_free(arena);
+    struct au_chunk *chunk = malloc(sizeof(struct au_chunk) + size);
+    if (chunk == NULL)
+      return;
+    chunk->next = NULL;
+    chunk->size = size;
+    arena->head = chunk;
+    arena->size = size;
+  }
+  arena->cur = arena->head;
+  if (arena->cur != NULL) {
+    arena->ptr = (char *)arena->cur->data;
+    arena->end = arena->ptr + arena->cur->size;
+  }
+}
+
+void au_arena_free(au_arena_t *arena)
+{
+  for (struct au_chunk *chunk = arena->head, *next; chunk != NULL; chunk = next) {
+    next = chunk->next;
+    free(chunk);
+  }
+  memset(arena, 0, sizeof(au_arena_t));
+}
+
+
+/// Stop threads of a context, see unroll_parallel
+static void pool_free(au_pool_t *pool);
+
+void au_ctx_init(au_ctx_t *ctx)
+{
+  memset(ctx, 0, sizeof(au_ctx_t));
+}
+
+void au_ctx_reset(au_ctx_t *ctx)
+{
+  au_arena_reset(&ctx->arena);
+}
+
+void au_ctx_free(au_ctx_t *ctx)
+{
+  au_arena_free(&ctx->arena);
+  free(ctx->refs);
+  free(ctx->offs);
+  pool_free(ctx->pool);
+  au_ctx_init(ctx);
+}
 
 #define ERROR(msg) \
   do { \
-    error = (msg); \
+    ctx->error = (msg); \
     return false; \
   } while (0)
 
 
-#define CHARACTER_CLASSES "iIkKfFpPsSdDxXoOwWhHaAlLuU"
-
 void print_token(const token_t *tok)
 {
   char buf[256] = {0};
@@ -76,232 +188,340 @@ void print_tokens(const token_t **toks)
 }
 
 
-token_t *tokenize(const char *pat)
+/// Character classification for tokenize. Everything that isn't
+/// listed here is a literal.
+enum {
+  C_LIT = 0,
+  C_PUSH,     // {
+  C_POP,      // }
+  C_BRANCH,   // ,
+  C_ESCAPE,   // backslash
+  C_SET,      // [
+  C_ANYCHARS, // *
+  C_ANYCHAR,  // ?
+};
+
+static const uint8_t char_class[256] = {
+  ['{'] = C_PUSH,
+  ['}'] = C_POP,
+  [','] = C_BRANCH,
+  ['\\'] = C_ESCAPE,
+  ['['] = C_SET,
+  ['*'] = C_ANYCHARS,
+  ['?'] = C_ANYCHAR,
+};
+
+/// Classification of the character after a backslash
+enum {
+  E_UNKNOWN = 0,
+  E_PUSH,       // \(
+  E_POP,        // \)
+  E_BRANCH,     // \|
+  E_LITERAL,    // \, \? \{ \}
+  E_ZEROORMORE, // \*
+  E_ONEORMORE,  // \+
+  E_ZEROORONE,  // \=
+  E_CLS,        // \d \s ...
+  E_CLS_NL,     // \_
+  E_BACKSLASH,  // \\ .
+  E_OPTS,       // \c \C ...
+};
+
+static const uint8_t escape_class[256] = {
+  ['('] = E_PUSH,
+  [')'] = E_POP,
+  ['|'] = E_BRANCH,
+  [','] = E_LITERAL, ['?'] = E_LITERAL, ['{'] = E_LITERAL, ['}'] = E_LITERAL,
+  ['*'] = E_ZEROORMORE,
+  ['+'] = E_ONEORMORE,
+  ['='] = E_ZEROORONE,
+  ['i'] = E_CLS, ['I'] = E_CLS, ['k'] = E_CLS, ['K'] = E_CLS,
+  ['f'] = E_CLS, ['F'] = E_CLS, ['p'] = E_CLS, ['P'] = E_CLS,
+  ['s'] = E_CLS, ['S'] = E_CLS, ['d'] = E_CLS, ['D'] = E_CLS,
+  ['x'] = E_CLS, ['X'] = E_CLS, ['o'] = E_CLS, ['O'] = E_CLS,
+  ['w'] = E_CLS, ['W'] = E_CLS, ['h'] = E_CLS, ['H'] = E_CLS,
+  ['a'] = E_CLS, ['A'] = E_CLS, ['l'] = E_CLS, ['L'] = E_CLS,
+  ['u'] = E_CLS, ['U'] = E_CLS,
+  ['_'] = E_CLS_NL,
+  ['\\'] = E_BACKSLASH,
+  ['c'] = E_OPTS, ['C'] = E_OPTS, ['Z'] = E_OPTS, ['m'] = E_OPTS,
+  ['M'] = E_OPTS, ['v'] = E_OPTS, ['V'] = E_OPTS,
+};
+
+/// Characters allowed in character sets, besides nested [ and ]
+static const bool set_char[256] = {
+  ['0'] = 1, ['1'] = 1, ['2'] = 1, ['3'] = 1, ['4'] = 1,
+  ['5'] = 1, ['6'] = 1, ['7'] = 1, ['8'] = 1, ['9'] = 1,
+  ['a'] = 1, ['b'] = 1, ['c'] = 1, ['d'] = 1, ['e'] = 1, ['f'] = 1, ['g'] = 1,
+  ['h'] = 1, ['i'] = 1, ['j'] = 1, ['k'] = 1, ['l'] = 1, ['m'] = 1, ['n'] = 1,
+  ['o'] = 1, ['p'] = 1, ['q'] = 1, ['r'] = 1, ['s'] = 1, ['t'] = 1, ['u'] = 1,
+  ['v'] = 1, ['w'] = 1, ['x'] = 1, ['y'] = 1, ['z'] = 1,
+  ['A'] = 1, ['B'] = 1, ['C'] = 1, ['D'] = 1, ['E'] = 1, ['F'] = 1, ['G'] = 1,
+  ['H'] = 1, ['I'] = 1, ['J'] = 1, ['K'] = 1, ['L'] = 1, ['M'] = 1, ['N'] = 1,
+  ['O'] = 1, ['P'] = 1, ['Q'] = 1, ['R'] = 1, ['S'] = 1, ['T'] = 1, ['U'] = 1,
+  ['V'] = 1, ['W'] = 1, ['X'] = 1, ['Y'] = 1, ['Z'] = 1,
+  ['-'] = 1, ['_'] = 1, ['.'] = 1, [':'] = 1,
+};
+
+/// Skip literal characters
+/// @return     pointer to the first special character, or end
+static const char *skip_literal(const char *it, const char *end)
+{
+#if defined(__AVX2__)
+  const __m256i c0 = _mm256_set1_epi8('{'), c1 = _mm256_set1_epi8('}');
+  const __m256i c2 = _mm256_set1_epi8(','), c3 = _mm256_set1_epi8('\\');
+  const __m256i c4 = _mm256_set1_epi8('['), c5 = _mm256_set1_epi8('*');
+  const __m256i c6 = _mm256_set1_epi8('?');
+  for (; end - it >= 32; it += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)it);
+    __m256i m = _mm256_or_si256(
+        _mm256_or_si256(
+          _mm256_or_si256(_mm256_cmpeq_epi8(v, c0), _mm256_cmpeq_epi8(v, c1)),
+          _mm256_or_si256(_mm256_cmpeq_epi8(v, c2), _mm256_cmpeq_epi8(v, c3))),
+        _mm256_or_si256(
+          _mm256_or_si256(_mm256_cmpeq_epi8(v, c4), _mm256_cmpeq_epi8(v, c5)),
+          _mm256_cmpeq_epi8(v, c6)));
+    uint32_t mask = _mm256_movemask_epi8(m);
+    if (mask != 0)
+      return it + __builtin_ctz(mask);
+  }
+#endif
+#if defined(__SSE2__)
+  const __m128i s0 = _mm_set1_epi8('{'), s1 = _mm_set1_epi8('}');
+  const __m128i s2 = _mm_set1_epi8(','), s3 = _mm_set1_epi8('\\');
+  const __m128i s4 = _mm_set1_epi8('['), s5 = _mm_set1_epi8('*');
+  const __m128i s6 = _mm_set1_epi8('?');
+  for (; end - it >= 16; it += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)it);
+    __m128i m = _mm_or_si128(
+        _mm_or_si128(
+          _mm_or_si128(_mm_cmpeq_epi8(v, s0), _mm_cmpeq_epi8(v, s1)),
+          _mm_or_si128(_mm_cmpeq_epi8(v, s2), _mm_cmpeq_epi8(v, s3))),
+        _mm_or_si128(
+          _mm_or_si128(_mm_cmpeq_epi8(v, s4), _mm_cmpeq_epi8(v, s5)),
+          _mm_cmpeq_epi8(v, s6)));
+    uint32_t mask = _mm_movemask_epi8(m);
+    if (mask != 0)
+      return it + __builtin_ctz(mask);
+  }
+#endif
+  while (it < end && char_class[(uint8_t)*it] == C_LIT)
+    ++it;
+  return it;
+}
+
+token_t *tokenize(au_ctx_t *ctx, const char *pat)
+{
+  return tokenize_n(ctx, pat, strlen(pat));
+}
+
+token_t *tokenize_n(au_ctx_t *ctx, const char *pat, size_t len)
 {
 #define ERR(msg) \
   do { \
-    error = (msg); \
-    free(toks); \
+    ctx->error = (msg); \
     return NULL; \
   } while (0)
 
-#define PUSH(TYPE, BEGIN, LEN) \
+#define PUSH(TYPE, BEGIN, LEN, LVL) \
   do { \
     if (size >= cap) { \
-      cap *= 2; \
-      token_t *ntoks = realloc(toks, cap * sizeof(token_t)); \
+      token_t *ntoks = au_arena_realloc(&ctx->arena, toks, \
+          cap * sizeof(token_t), cap * 2 * sizeof(token_t)); \
       if (ntoks == NULL) \
-        ERR("realloc"); \
+        ERR("malloc"); \
       toks = ntoks; \
+      cap *= 2; \
     } \
     toks[size++] = (token_t){ \
-      .type=(TYPE), .beg=(BEGIN), .len=(LEN), .lvl=0 \
+      .type=(TYPE), .beg=(BEGIN), .len=(LEN), .lvl=(LVL) \
     }; \
-    ++pushed; \
   } while (0)
 
+  if (len > UINT32_MAX)
+    ERR("pattern too long");
+
   size_t size = 0;
   size_t cap = 64;
-  token_t *toks = malloc(cap * sizeof(token_t));
+  token_t *toks = au_arena_alloc(&ctx->arena, cap * sizeof(token_t));
   if (toks == NULL)
     ERR("malloc");
 
-  const char *it;
-  size_t pushed = 0;
-  const char *literal = NULL;
-  const char *beg = pat;
-  bool isliteral = false;
-
-  for (it = pat; *it != '\0'; ++it) {
-    beg = it;
-    pushed = 0;
-    isliteral = false;
-
-    if (*it == '{') {
-      // open group
-      PUSH(Push, it, 1);
-    } else if (*it == '}') {
-      // close group
-      PUSH(Pop, it, 1);
-    } else if (*it == ',') {
-      // pattern separator
-      PUSH(Branch, it, 1);
-    } else if (*it == '\\') {
-      const char *beg2 = it;
-      if (*(++it) == '\0') {
-        ERR("unexpected end after '\\'");
-      } else if (*it == '(') {
-        // open group, same as {
-        // this is wrong, the level of nesting shouldn't be shared, but whatever
-        PUSH(Push, beg2, 2);
-      } else if (*it == ')') {
-        // close group, same as }
-        PUSH(Pop, beg2, 2);
-      } else if (*it == '|') {
-        // pattern separator, same as ,
-        PUSH(Branch, beg2, 2);
-      } else if (strchr(",?{}", *it)) {
-        // literal , ? { }
-        isliteral = true;
-      } else if (*it == '*') {
-        PUSH(ZeroOrMore, beg2, 2);
-      } else if (*it == '+') {
-        PUSH(OneOrMore, beg2, 2);
-      } else if (*it == '=') {
-        PUSH(ZeroOrOne, beg2, 2);
-      } else if (strchr(CHARACTER_CLASSES, *it)) {
-        PUSH(Cls, beg2, 2);
-      } else if (*it == '_') {
-        if (*(++it) == '\0') {
-          ERR("unexpected end after '_'");
-        } else if (strchr(CHARACTER_CLASSES, *it)) {
-          PUSH(Cls, beg2, 3);
-        } else {
-          ERR("unknown character class after '_'");
+  const char *it = pat;
+  const char *end = pat + len;
+  const char *literal = NULL; // start of pending literal
+  int lvl = 0;
+  bool underflow = false; // reported after everything else, like before
+
+  while (it < end) {
+    const char *beg = it;
+    type_t type;
+
+    switch (char_class[(uint8_t)*it]) {
+      case C_LIT:
+        if (literal == NULL)
+          literal = it;
+        it = skip_literal(it + 1, end);
+        continue;
+      case C_PUSH:
+        type = Push;
+        ++it;
+        break;
+      case C_POP:
+        type = Pop;
+        ++it;
+        break;
+      case C_BRANCH:
+        type = Branch;
+        ++it;
+        break;
+      case C_ANYCHARS:
+        type = AnyChars;
+        ++it;
+        break;
+      case C_ANYCHAR:
+        type = AnyChar;
+        ++it;
+        break;
+      case C_SET:
+        // character set ([abc])
+        if (++it == end)
+          ERR("unclosed '['");
+        if (*it == '^') // negated character set ([^abc])
+          ++it;
+        for (bool nested = false;; ++it) {
+          if (it == end) {
+            ERR("unclosed '['");
+          } else if (*it == '[') {
+            if (nested)
+              ERR("unexpected '['");
+            nested = true;
+          } else if (*it == ']') {
+            if (!nested)
+              break;
+            nested = false;
+          } else if (!set_char[(uint8_t)*it]) {
+            ERR("character from character set not supported");
+          }
         }
-      } else if (*it == '\\') {
-        if (*(++it) == '\0') {
+        type = Set;
+        ++it;
+        break;
+      case C_ESCAPE:
+        if (++it == end)
           ERR("unexpected end after '\\'");
-        } else if (*it == '\\') {
-          if (*(++it) == '\0') {
-            ERR("unexpected end after '\\'");
-          } else if (*it == '{') {
+        switch (escape_class[(uint8_t)*it++]) {
+          case E_LITERAL:
+            // literal , ? { }
+            if (literal == NULL)
+              literal = beg;
+            continue;
+          case E_PUSH:
+            // open group, same as {
+            // this is wrong, the level of nesting shouldn't be shared, but whatever
+            type = Push;
+            break;
+          case E_POP:
+            // close group, same as }
+            type = Pop;
+            break;
+          case E_BRANCH:
+            // pattern separator, same as ,
+            type = Branch;
+            break;
+          case E_ZEROORMORE:
+            type = ZeroOrMore;
+            break;
+          case E_ONEORMORE:
+            type = OneOrMore;
+            break;
+          case E_ZEROORONE:
+            type = ZeroOrOne;
+            break;
+          case E_CLS:
+            type = Cls;
+            break;
+          case E_CLS_NL:
+            if (it == end)
+              ERR("unexpected end after '_'");
+            if (escape_class[(uint8_t)*it++] != E_CLS)
+              ERR("unknown character class after '_'");
+            type = Cls;
+            break;
+          case E_BACKSLASH:
+            if (it == end)
+              ERR("unexpected end after '\\'");
+            if (*it++ != '\\')
+              ERR("unknown escape sequence");
+            if (it == end)
+              ERR("unexpected end after '\\'");
+            if (*it++ != '{')
+              ERR("unknown escape sequence");
             // lua: {} (*), {-} (-), {n} {-n} (unroll)
             // vim: {n,m} {n,} {,m} {-n,m} {-n,} {-,m}
-            if (*(++it) == '\0')
+            if (it == end)
               ERR("unexpected end after '{'");
             if (*it == '-')
               ++it;
-            while (isdigit(*it))
+            while (it < end && isdigit((unsigned char)*it))
               ++it;
-            if (*it == ',')
+            if (it < end && *it == ',')
               ++it;
-            while (isdigit(*it))
+            while (it < end && isdigit((unsigned char)*it))
               ++it;
-            if (*it != '\\')
+            if (it == end || *it != '\\')
               ERR("invalid '{}' atom");
-            if (*(++it) != '}')
+            if (++it == end || *it != '}')
               ERR("invalid '{}' atom");
-            PUSH(Count, beg2, it - beg2 + 1);
-          } else {
-            ERR("unknown escape sequence");
-          }
-        } else {
-          ERR("unknown escape sequence");
-        }
-      } else if (*it == '{') {
-        ERR("unknown regex pattern '\\{'");
-      } else if (strchr("cCZmMvV", *it)) {
-        // vim regex settings. force vim pattern
-        PUSH(Opts, beg2, 2);
-      } else {
-        ERR("unknown regex pattern");
-      }
-    } else if (*it == '[') {
-      // character set ([abc])
-      const char *beg2 = it;
-      if (*(++it) == '\0')
-        ERR("unclosed '['");
-      if (*it == '^') // negated character set ([^abc])
-        ++it;
-      for (bool nested = false;; ++it) {
-        if (*it == '\0') {
-          ERR("unclosed '['");
-        } else if (*it == '[') {
-          if (nested)
-            ERR("unexpected '['");
-          nested = true;
-        } else if (*it == ']') {
-          if (nested) {
-            nested = false;
-          } else {
-            PUSH(Set, beg2, it - beg2 + 1);
+            ++it;
+            type = Count;
             break;
-          }
-        } else if (!isalnum(*it) && !strchr("-_.:", *it)) {
-          ERR("character from character set not supported");
+          case E_OPTS:
+            // vim regex settings. force vim pattern
+            type = Opts;
+            break;
+          default:
+            ERR("unknown regex pattern");
         }
-      }
-    } else if (*it == '*') {
-      PUSH(AnyChars, it, 1);
-    } else if (*it == '?') {
-      PUSH(AnyChar, it, 1);
-    } else {
-      isliteral = true;
+        break;
+      default:
+        ERR("unknown character");
     }
 
-    if (!isliteral && pushed == 0) {
-      ERR("not a literal and nothing was pushed");
-    } else if (isliteral && literal == NULL) {
-      literal = beg;
-    } else if (!isliteral) {
-      // push literals
-      if (literal != NULL) {
-        if (pushed > 0) {
-          // since we're pushing the literal after we
-          // got a non-literal, swap with last token
-          if (pushed != 1)
-            ERR("pushed != 1");
-          token_t copy = toks[--size];
-          PUSH(Literal, literal, beg - literal);
-          PUSH(copy.type, copy.beg, copy.len);
-        } else {
-          PUSH(Literal, literal, beg - literal);
-        }
-        literal = NULL;
-      }
+    // push pending literal before the token
+    if (literal != NULL) {
+      PUSH(Literal, literal, beg - literal, lvl);
+      literal = NULL;
+    }
 
+    if (type == Branch || type == Pop) {
       // add empty literals for empty branches
-      if (size > 1) {
-        type_t t1 = toks[size - 1].type;
-        type_t t2 = toks[size - 2].type;
-        if ((t1 == Branch || t1 == Pop) && (t2 == Push || t2 == Branch)) {
-          token_t copy = toks[--size];
-          PUSH(Empty, "", 0);
-          PUSH(copy.type, copy.beg, copy.len);
-        }
-      }
+      if (size > 0 && (toks[size - 1].type == Push || toks[size - 1].type == Branch))
+        PUSH(Empty, "", 0, lvl);
     }
-  }
 
-  if (isliteral) {
-    // push literals
-    if (literal != NULL) {
-      PUSH(Literal, literal, it - literal);
+    if (type == Push) {
+      if (++lvl > UINT16_MAX)
+        ERR("pattern too deeply nested");
+      PUSH(type, beg, it - beg, lvl);
+    } else if (type == Pop) {
+      PUSH(type, beg, it - beg, lvl);
+      if (--lvl < 0)
+        underflow = true;
     } else {
-      PUSH(Literal, beg, 1);
-    }
-  } else if (size > 1) {
-    // add empty literals for empty branches
-    type_t t1 = toks[size - 1].type;
-    type_t t2 = toks[size - 2].type;
-    if ((t1 == Branch || t1 == Pop) && (t2 == Push || t2 == Branch)) {
-      token_t copy = toks[--size];
-      PUSH(Empty, "", 0);
-      PUSH(copy.type, copy.beg, copy.len);
+      PUSH(type, beg, it - beg, lvl);
     }
   }
 
-  {
-    // set levels
-    int lvl = 0;
-    for (size_t j = 0; j < size; ++j) {
-      if (toks[j].type == Push) {
-        toks[j].lvl = ++lvl;
-      } else if (toks[j].type == Pop) {
-        toks[j].lvl = lvl--;
-        if (lvl < 0)
-          ERR("unexpected branch close");
-      } else {
-        toks[j].lvl = lvl;
-      }
-    }
-    if (lvl != 0) {
-      ERR("unclosed branch");
-    }
-  }
+  if (literal != NULL)
+    PUSH(Literal, literal, it - literal, lvl);
+
+  if (underflow)
+    ERR("unexpected branch close");
+  if (lvl != 0)
+    ERR("unclosed branch");
 
-  PUSH(End, NULL, 0);
+  PUSH(End, NULL, 0, 0);
   return toks;
 
 #undef PUSH
@@ -309,258 +529,1109 @@ token_t *tokenize(const char *pat)
 }
 
 
-// unroll stack
-#define USTACK_SIZE (256)
-static const token_t *ustack[USTACK_SIZE] = {0};
-static size_t ussize = 0;
-// unroll results
-static const token_t ***ures = NULL;
-static size_t ures_cap = 0;
-static size_t ures_size = 0;
+static inline size_t sat_add(size_t a, size_t b)
+{
+  size_t r;
+  return __builtin_add_overflow(a, b, &r) ? SIZE_MAX : r;
+}
 
-static bool unroll_rec(const token_t *toks, int lvl)
+static inline size_t sat_mul(size_t a, size_t b)
 {
-  if (!toks->type)
-    return true;
-  if (lvl > 8)
-    ERROR("pattern too deeply nested");
-
-  bool left = false; // left current branch
-  size_t ssize_p; // saved stack size
-  int tlvl; // temporary level
-
-  for (const token_t *it = toks; it->type; ++it) {
-    // if below current level, we for sure already left the current branch.
-    // we need to keep track of this, because there could be other branches
-    // with the same level later, eg. `{a,b}c{d,e}`
-    if (it->lvl < lvl)
-      left = true;
-
-    // skip other branches for the current level
-    if (!left && it->lvl == lvl) {
-      if (it->type == Branch) {
-        // another branch for the current level, skip it
-        while (it->type && it->lvl >= lvl && !(it->lvl == lvl && it->type == Pop))
-          ++it;
-        --it;
-        continue;
-      } else if (it->type == Pop) {
-        // pop for current level, we left the current branch
-        left = true;
-        continue;
-      }
+  size_t r;
+  return __builtin_mul_overflow(a, b, &r) ? SIZE_MAX : r;
+}
+
+bool au_unroll_count(au_ctx_t *ctx, const token_t *toks, size_t *count)
+{
+  if (!toks->type) {
+    ctx->error = "pattern is empty";
+    return false;
+  }
+
+  int maxlvl = 0;
+  for (const token_t *t = toks; t->type; ++t) {
+    if (t->lvl > maxlvl)
+      maxlvl = t->lvl;
+  }
+
+  // for every open group: branches from the alternatives before the
+  // current one, and branches from the current alternative so far
+  struct { size_t sum, prod; } *frames =
+    au_arena_alloc(&ctx->arena, (maxlvl + 1) * sizeof(*frames));
+  if (frames == NULL) {
+    ctx->error = "malloc";
+    return false;
+  }
+
+  size_t total = 0;
+  bool nonempty = false; // root level branch isn't empty
+  int lvl = 0;
+  frames[0].prod = 1;
+  for (const token_t *t = toks;; ++t) {
+    if (t->type == End || (t->type == Branch && t->lvl == 0)) {
+      if (nonempty)
+        total = sat_add(total, frames[0].prod);
+      if (t->type == End)
+        break;
+      frames[0].prod = 1;
+      nonempty = false;
+    } else if (t->type == Push) {
+      nonempty = true;
+      lvl = t->lvl;
+      frames[lvl].sum = 0;
+      frames[lvl].prod = 1;
+    } else if (t->type == Branch) {
+      frames[lvl].sum = sat_add(frames[lvl].sum, frames[lvl].prod);
+      frames[lvl].prod = 1;
+    } else if (t->type == Pop) {
+      size_t n = sat_add(frames[lvl].sum, frames[lvl].prod);
+      --lvl;
+      frames[lvl].prod = sat_mul(frames[lvl].prod, n);
+    } else if (t->type != Empty) {
+      nonempty = true;
     }
+  }
 
-    // unroll every branch we encounter
-    if (it->type == Push) {
-      tlvl = it->lvl;
-      ++it;
-      ssize_p = ussize;
-      if (!unroll_rec(it, tlvl))
-        return false;
-      ussize = ssize_p; // restore stack
-      for (; it->type; ++it) {
-        if (it->lvl < tlvl)
-          break;
-        if (it->lvl == tlvl) {
-          if (it->type == Pop)
-            break;
-          if (it->type == Branch) {
-            ++it;
-            ssize_p = ussize;
-            if (!unroll_rec(it, tlvl))
-              return false;
-            ussize = ssize_p; // restore stack
-          }
-        }
+  *count = total;
+  return true;
+}
+
+/// Link Push and Branch tokens to the Branch or Pop after them, and to
+/// the Pop that closes their group
+/// @return     NULL if memory allocation failed
+static au_jump_t *link_groups(au_ctx_t *ctx, const token_t *toks)
+{
+  size_t n = 0;
+  size_t maxlvl = 0;
+  for (; toks[n].type; ++n) {
+    if (toks[n].lvl > maxlvl)
+      maxlvl = toks[n].lvl;
+  }
+
+  au_jump_t *jumps = au_arena_alloc(&ctx->arena, (n > 0 ? n : 1) * sizeof(au_jump_t));
+  struct { uint32_t push, last; } *open = au_arena_alloc(&ctx->arena, (maxlvl + 1) * sizeof(*open));
+  if (jumps == NULL || open == NULL) {
+    ctx->error = "malloc";
+    return NULL;
+  }
+
+  // once a group is closed, link all of its Push and Branch tokens to the Pop
+  for (size_t i = 0; i < n; ++i) {
+    const token_t *t = &toks[i];
+    if (t->type == Push) {
+      open[t->lvl].push = open[t->lvl].last = i;
+    } else if ((t->type == Branch && t->lvl > 0) || t->type == Pop) {
+      jumps[open[t->lvl].last].next = i;
+      open[t->lvl].last = i;
+      if (t->type == Pop) {
+        for (uint32_t k = open[t->lvl].push; k != i; k = jumps[k].next)
+          jumps[k].pop = i;
       }
+    }
+  }
+  return jumps;
+}
+
+token_t *tokenize_jumps(au_ctx_t *ctx, const char *pat, size_t len, au_jump_t **jumps)
+{
+  token_t *toks = tokenize_n(ctx, pat, len);
+  if (toks == NULL)
+    return NULL;
+  *jumps = link_groups(ctx, toks);
+  return *jumps != NULL ? toks : NULL;
+}
+
+bool au_unroll_init(au_ctx_t *ctx, au_unroll_t *it, const token_t *toks)
+{
+  return au_unroll_init_jumps(ctx, it, toks, NULL);
+}
+
+/// Fail if there are more branches than ctx->unroll_max
+static bool unroll_limit(au_ctx_t *ctx, size_t count)
+{
+  if (ctx->unroll_max != 0 && count > ctx->unroll_max) {
+    ctx->error = "too many branches";
+    return false;
+  }
+  return true;
+}
+
+/// Same as au_unroll_init_jumps, without checking ctx->unroll_max
+static bool unroll_init(au_ctx_t *ctx, au_unroll_t *it, const token_t *toks, const au_jump_t *jumps)
+{
+  if (!toks->type) {
+    ctx->error = "pattern is empty";
+    return false;
+  }
+
+  size_t n = 0;
+  size_t npush = 0;
+  for (; toks[n].type; ++n)
+    npush += toks[n].type == Push;
+
+  if (jumps == NULL && (jumps = link_groups(ctx, toks)) == NULL)
+    return false;
+  // every group can be on the path at most once, and a branch can't
+  // be longer than the pattern
+  it->choices = au_arena_alloc(&ctx->arena, (npush + 1) * sizeof(const token_t *));
+  it->buf = au_arena_alloc(&ctx->arena, (n + 1) * sizeof(const token_t *));
+  if (it->choices == NULL || it->buf == NULL) {
+    ctx->error = "malloc";
+    return false;
+  }
+
+  it->ctx = ctx;
+  it->toks = toks;
+  it->jumps = jumps;
+  it->root = toks;
+  it->rootend = NULL;
+  it->started = false;
+  it->nchoices = 0;
+  it->nfixed = 0;
+  it->single = false;
+  return true;
+}
+
+bool au_unroll_init_jumps(au_ctx_t *ctx, au_unroll_t *it, const token_t *toks, const au_jump_t *jumps)
+{
+  if (ctx->unroll_max != 0) {
+    size_t count;
+    if (!au_unroll_count(ctx, toks, &count) || !unroll_limit(ctx, count))
+      return false;
+  }
+  return unroll_init(ctx, it, toks, jumps);
+}
+
+/// Move to the next combination of alternatives, last group first
+/// @return     false if every combination was produced
+static bool unroll_advance(au_unroll_t *it)
+{
+  while (it->nchoices > it->nfixed) {
+    // alternative ends at the Branch or Pop after the Push or Branch before it
+    const token_t *t = it->choices[it->nchoices - 1];
+    const token_t *end = it->toks + it->jumps[t - 1 - it->toks].next;
+    if (end->type == Branch) {
+      it->choices[it->nchoices - 1] = end + 1;
       return true;
     }
+    --it->nchoices;
+  }
+  return false;
+}
 
-    if (it->type == Branch) {
-      if (it ->lvl <= lvl)
-        break;
-      continue;
+/// Collect tokens for the current combination of alternatives.
+/// Groups not chosen yet start with their first alternative.
+/// @return     number of tokens
+static size_t unroll_walk(au_unroll_t *it)
+{
+  size_t n = 0;
+  size_t k = 0;
+  const token_t *t = it->root;
+  while (t->type && !(t->type == Branch && t->lvl == 0)) {
+    if (t->type == Push) {
+      if (k == it->nchoices)
+        it->choices[it->nchoices++] = t + 1;
+      t = it->choices[k++];
+    } else if (t->type == Branch) {
+      // end of the chosen alternative, skip the rest of the group
+      t = it->toks + it->jumps[t - it->toks].pop + 1;
+    } else if (t->type == Pop || t->type == Empty) {
+      ++t;
+    } else {
+      it->buf[n++] = t++;
     }
+  }
+  it->buf[n] = NULL;
+  it->rootend = t;
+  return n;
+}
 
-    if (it->type == Pop) {
-      // break out from branches at the current level,
-      // they're handled by recursive calls
-      if (it->lvl == lvl)
-        break;
+bool au_unroll_next(au_unroll_t *it, const token_t ***out)
+{
+  *out = NULL;
+  while (it->root != NULL) {
+    if (it->started && !unroll_advance(it)) {
+      // move on to the next root level branch
+      it->root = it->rootend->type && !it->single ? it->rootend + 1 : NULL;
+      it->started = false;
       continue;
     }
+    it->started = true;
 
-    if (it->type != Empty) {
-      if (ussize >= USTACK_SIZE)
-        ERROR("stack overflow");
-      ustack[ussize++] = it;
+    size_t n = unroll_walk(it);
+    // ignore empty branches on root level, but not empty alternatives
+    if (n > 0 || it->nchoices > 0) {
+      *out = it->buf;
+      return true;
     }
   }
+  return true;
+}
+
+
+/// Make room for n elements in a growable array
+static bool reserve(uint32_t **arr, size_t *cap, size_t n)
+{
+  if (n <= *cap)
+    return true;
+  size_t ncap = *cap ? *cap * 2 : 256;
+  while (ncap < n)
+    ncap *= 2;
+  uint32_t *narr = realloc(*arr, ncap * sizeof(uint32_t));
+  if (narr == NULL)
+    return false;
+  *arr = narr;
+  *cap = ncap;
+  return true;
+}
+
+/// Branches in growable arrays, in the same form as au_branches_t
+typedef struct {
+  uint32_t *refs;
+  size_t refs_cap;
+  uint32_t *offs;
+  size_t offs_cap;
+  size_t nbranches;
+} unroll_out_t;
 
-  // ignore empty branches on root level
-  if (lvl == 0) {
-    bool isempty = true;
-    for (size_t i = 0; i < ussize; ++i) {
-      if (ustack[i]->type != Empty)
-        isempty = false;
+/// Collect all branches from iterator. offs is terminated even on failure,
+/// unless it couldn't be allocated.
+/// @return     error message, NULL on success
+static const char *unroll_collect(au_unroll_t *it, unroll_out_t *out)
+{
+  const char *error = NULL;
+  size_t n = 0;
+  size_t nrefs = 0;
+  const token_t **branch;
+  while (au_unroll_next(it, &branch) && branch != NULL) {
+    size_t len = 0;
+    while (branch[len] != NULL)
+      ++len;
+    if (nrefs + len > UINT32_MAX) {
+      error = "too many branches";
+      break;
     }
-    if (isempty)
+    if (!reserve(&out->offs, &out->offs_cap, n + 2) || !reserve(&out->refs, &out->refs_cap, nrefs + len)) {
+      error = "realloc";
+      break;
+    }
+    out->offs[n++] = nrefs;
+    for (size_t i = 0; i < len; ++i)
+      out->refs[nrefs++] = branch[i] - it->toks;
+  }
+
+  if (!reserve(&out->offs, &out->offs_cap, n + 1))
+    return "realloc";
+  out->offs[n] = nrefs;
+  out->nbranches = n;
+  return error;
+}
+
+/// Unroll into the context scratch arrays, they're reused between calls.
+/// The branch limit has to be checked already.
+/// @param[out] out   branches in the scratch arrays, same as au_unroll_flat
+static bool unroll_scratch(au_ctx_t *ctx, const token_t *toks, au_branches_t *out)
+{
+  *out = (au_branches_t){ .toks = toks };
+  au_unroll_t it;
+  if (!unroll_init(ctx, &it, toks, NULL))
+    return false;
+
+  unroll_out_t res = { ctx->refs, ctx->refs_cap, ctx->offs, ctx->offs_cap, 0 };
+  const char *error = unroll_collect(&it, &res);
+  ctx->refs = res.refs;
+  ctx->refs_cap = res.refs_cap;
+  ctx->offs = res.offs;
+  ctx->offs_cap = res.offs_cap;
+  if (error != NULL)
+    ctx->error = error;
+  if (ctx->offs_cap == 0)
+    return false;
+  out->refs = ctx->refs;
+  out->offs = ctx->offs;
+  out->nbranches = res.nbranches;
+  return error == NULL;
+}
+
+
+// Parallel unroll. The pattern is split into tasks: root level branches,
+// and then parts of them where alternatives of the first groups on the
+// path are fixed, until there are enough tasks to keep all threads busy.
+// Unrolling the next part of a branch only changes choices after the
+// fixed ones, so every task produces a consecutive run of the branches
+// unroll would, and they're concatenated in order at the end.
+//
+// Tasks are handed out by a work stealing pool. Every worker starts with
+// an equal range of tasks and takes them from the front. When it runs out,
+// it steals the back half of the range of another worker.
+
+/// Tasks per thread to split the pattern into, more of them keep threads
+/// busy when some of them are much bigger than others
+#define UNROLL_TASKS_PER_THREAD (16)
+
+/// Tasks left for a worker
+typedef struct {
+  pthread_mutex_t lock;
+  size_t lo;
+  size_t hi;
+} pool_range_t;
+
+typedef struct {
+  au_pool_t *pool;
+  size_t id;
+} pool_worker_t;
+
+/// Threads of a context, kept between patterns. The thread that runs
+/// the pool is worker 0, started threads are the others.
+struct au_pool {
+  pthread_mutex_t lock;
+  pthread_cond_t wake;          /// there's a new run
+  pthread_cond_t done;          /// started threads finished the run
+  pool_range_t *ranges;         /// for every worker
+  pool_worker_t *workers;
+  size_t nworkers;
+  pthread_t *threads;
+  size_t nthreads;              /// threads that were started
+  void (*fn)(void *arg, size_t task, size_t worker);
+  void *arg;
+  uint64_t run;                 /// incremented for every run
+  size_t active;                /// started threads still busy with the run
+  bool quit;
+};
+
+/// Take next task, stealing from other workers when out of them
+/// @return     false when there are no tasks left
+static bool pool_take(au_pool_t *pool, size_t w, size_t *task)
+{
+  pool_range_t *own = &pool->ranges[w];
+  for (;;) {
+    pthread_mutex_lock(&own->lock);
+    bool ok = own->lo < own->hi;
+    if (ok)
+      *task = own->lo++;
+    pthread_mutex_unlock(&own->lock);
+    if (ok)
       return true;
+
+    size_t lo = 0, hi = 0;
+    for (size_t k = 1; k < pool->nworkers && lo == hi; ++k) {
+      pool_range_t *r = &pool->ranges[(w + k) % pool->nworkers];
+      pthread_mutex_lock(&r->lock);
+      if (r->lo < r->hi) {
+        lo = r->hi - (r->hi - r->lo + 1) / 2;
+        hi = r->hi;
+        r->hi = lo;
+      }
+      pthread_mutex_unlock(&r->lock);
+    }
+    if (lo == hi)
+      return false;
+    pthread_mutex_lock(&own->lock);
+    own->lo = lo;
+    own->hi = hi;
+    pthread_mutex_unlock(&own->lock);
   }
+}
 
-  // resize result array if necessary
-  if (ures_size >= ures_cap) {
-    ures_cap *= 2;
-    const token_t ***nures = realloc(ures, ures_cap * sizeof(const token_t**));
-    if (nures == NULL)
-      ERROR("realloc");
-    ures = nures;
+static void pool_work(au_pool_t *pool, size_t w)
+{
+  size_t task;
+  while (pool_take(pool, w, &task))
+    pool->fn(pool->arg, task, w);
+}
+
+static void *pool_thread(void *arg)
+{
+  pool_worker_t *pw = arg;
+  au_pool_t *pool = pw->pool;
+  uint64_t seen = 0;
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (pool->run == seen && !pool->quit)
+      pthread_cond_wait(&pool->wake, &pool->lock);
+    if (pool->quit)
+      break;
+    seen = pool->run;
+    pthread_mutex_unlock(&pool->lock);
+    pool_work(pool, pw->id);
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->active == 0)
+      pthread_cond_signal(&pool->done);
   }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
 
-  // write current stack state to results
-  const token_t **buf = malloc((ussize + 1) * sizeof(const token_t*));
-  if (buf == NULL)
-    ERROR("malloc");
-  memcpy(buf, ustack, ussize * sizeof(const token_t*));
-  buf[ussize] = NULL;
-  ures[ures_size++] = buf;
-  return true;
+static void pool_free(au_pool_t *pool)
+{
+  if (pool == NULL)
+    return;
+  pthread_mutex_lock(&pool->lock);
+  pool->quit = true;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+  for (size_t i = 0; i < pool->nthreads; ++i)
+    pthread_join(pool->threads[i], NULL);
+  for (size_t w = 0; w < pool->nworkers; ++w)
+    pthread_mutex_destroy(&pool->ranges[w].lock);
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->wake);
+  pthread_cond_destroy(&pool->done);
+  free(pool->ranges);
+  free(pool->threads);
+  free(pool->workers);
+  free(pool);
 }
 
-const token_t ***unroll(const token_t *toks)
+/// Start nworkers - 1 threads. If some of them can't be started, their
+/// tasks are taken by the others.
+/// @return     NULL if memory allocation failed
+static au_pool_t *pool_new(size_t nworkers)
 {
-  if (!toks->type) {
-    error = "pattern is empty";
+  au_pool_t *pool = calloc(1, sizeof(au_pool_t));
+  if (pool == NULL)
+    return NULL;
+  pool->ranges = malloc(nworkers * sizeof(pool_range_t));
+  pool->threads = malloc(nworkers * sizeof(pthread_t));
+  pool->workers = malloc(nworkers * sizeof(pool_worker_t));
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->wake, NULL);
+  pthread_cond_init(&pool->done, NULL);
+  if (pool->ranges == NULL || pool->threads == NULL || pool->workers == NULL) {
+    pool_free(pool);
     return NULL;
   }
+  pool->nworkers = nworkers;
+  for (size_t w = 0; w < nworkers; ++w) {
+    pthread_mutex_init(&pool->ranges[w].lock, NULL);
+    pool->ranges[w].lo = pool->ranges[w].hi = 0;
+    pool->workers[w] = (pool_worker_t){ pool, w };
+  }
+  for (size_t w = 1; w < nworkers; ++w) {
+    if (pthread_create(&pool->threads[pool->nthreads], NULL, pool_thread, &pool->workers[w]) == 0)
+      ++pool->nthreads;
+  }
+  return pool;
+}
+
+/// Run fn for every task on all workers, and wait for them to finish
+static void pool_run(au_pool_t *pool, size_t ntasks,
+    void (*fn)(void *arg, size_t task, size_t worker), void *arg)
+{
+  pthread_mutex_lock(&pool->lock);
+  for (size_t w = 0; w < pool->nworkers; ++w) {
+    pool->ranges[w].lo = ntasks * w / pool->nworkers;
+    pool->ranges[w].hi = ntasks * (w + 1) / pool->nworkers;
+  }
+  pool->fn = fn;
+  pool->arg = arg;
+  pool->active = pool->nthreads;
+  ++pool->run;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
 
-  // reset stack state
-  ures_size = 0;
-  ures_cap = 16;
-  ures = malloc(ures_cap * sizeof(const token_t**));
-  if (ures == NULL) {
-    error = "malloc";
-    return NULL;
+  pool_work(pool, 0);
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->active > 0)
+    pthread_cond_wait(&pool->done, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/// Part of a pattern unrolled by a single task
+typedef struct {
+  uint32_t root;            /// first token of the root level branch
+  uint32_t nfixed;          /// number of choices fixed for this task
+  const uint32_t *fixed;    /// first token of every fixed alternative
+  unroll_out_t out;         /// branches, token indexes are relative to the pattern
+  const char *error;
+  size_t branch;            /// where the branches go in the result
+  size_t ref;               /// where their tokens go
+} unroll_task_t;
+
+typedef struct {
+  const au_unroll_t *it;    /// iterator that tasks start from
+  unroll_task_t *tasks;
+  const token_t **choices;  /// for every worker, npush + 1
+  const token_t **bufs;     /// for every worker, ntoks + 1
+  size_t npush;
+  size_t ntoks;
+  au_branches_t *res;
+} unroll_pool_t;
+
+static void unroll_task(void *arg, size_t i, size_t w)
+{
+  unroll_pool_t *p = arg;
+  unroll_task_t *task = &p->tasks[i];
+  au_unroll_t it = *p->it;
+  it.choices = p->choices + w * (p->npush + 1);
+  it.buf = p->bufs + w * (p->ntoks + 1);
+  it.root = it.toks + task->root;
+  it.single = true;
+  it.nfixed = it.nchoices = task->nfixed;
+  for (size_t k = 0; k < task->nfixed; ++k)
+    it.choices[k] = it.toks + task->fixed[k];
+  task->error = unroll_collect(&it, &task->out);
+}
+
+/// Copy task results to where they go in the result
+static void unroll_merge(void *arg, size_t i, size_t w)
+{
+  (void)w;
+  unroll_pool_t *p = arg;
+  unroll_task_t *task = &p->tasks[i];
+  for (size_t k = 0; k < task->out.nbranches; ++k)
+    p->res->offs[task->branch + k] = task->ref + task->out.offs[k];
+  size_t n = task->out.offs[task->out.nbranches];
+  if (n > 0)
+    memcpy(p->res->refs + task->ref, task->out.refs, n * sizeof(uint32_t));
+}
+
+/// Find the first group on the path of a task that isn't fixed
+/// @return     index of its Push, 0 if there isn't one
+static uint32_t unroll_task_group(const au_unroll_t *it, const unroll_task_t *task)
+{
+  size_t k = 0;
+  const token_t *t = it->toks + task->root;
+  while (t->type && !(t->type == Branch && t->lvl == 0)) {
+    if (t->type == Push) {
+      if (k == task->nfixed)
+        return t - it->toks;
+      t = it->toks + task->fixed[k++];
+    } else if (t->type == Branch) {
+      t = it->toks + it->jumps[t - it->toks].pop + 1;
+    } else {
+      ++t;
+    }
   }
+  return 0;
+}
 
-  const token_t *it = toks;
-  const token_t *beg = it; // branch start
+/// Split tasks on the first group that isn't fixed yet, one for each
+/// of its alternatives, until there are enough of them
+/// @return     false if memory allocation failed
+static bool unroll_split(au_ctx_t *ctx, const au_unroll_t *it,
+    unroll_task_t **tasks, size_t *ntasks, size_t want)
+{
+  bool split = true;
+  while (split && *ntasks < want) {
+    split = false;
+    size_t n = 0;
+    for (size_t i = 0; i < *ntasks; ++i) {
+      uint32_t push = unroll_task_group(it, &(*tasks)[i]);
+      if (push == 0) {
+        ++n;
+        continue;
+      }
+      for (uint32_t b = push; it->toks[b].type != Pop; b = it->jumps[b].next)
+        ++n;
+      split = true;
+    }
+    // tasks that are too small cost more than they save
+    if (!split || n > want * UNROLL_TASKS_PER_THREAD)
+      break;
 
-  for (; it->type; ++it) {
-    // look for , at the root level
-    if (it->lvl == 0 && it->type == Branch) {
-      ussize = 0; // clean stack
-      if (!unroll_rec(beg, 0))
-        goto fail;
-      beg = it + 1;
+    unroll_task_t *next = au_arena_alloc(&ctx->arena, n * sizeof(unroll_task_t));
+    if (next == NULL)
+      return false;
+    n = 0;
+    for (size_t i = 0; i < *ntasks; ++i) {
+      const unroll_task_t *task = &(*tasks)[i];
+      uint32_t push = unroll_task_group(it, task);
+      if (push == 0) {
+        next[n++] = *task;
+        continue;
+      }
+      for (uint32_t b = push; it->toks[b].type != Pop; b = it->jumps[b].next) {
+        uint32_t *fixed = au_arena_alloc(&ctx->arena, (task->nfixed + 1) * sizeof(uint32_t));
+        if (fixed == NULL)
+          return false;
+        if (task->nfixed > 0)
+          memcpy(fixed, task->fixed, task->nfixed * sizeof(uint32_t));
+        fixed[task->nfixed] = b + 1;
+        next[n++] = (unroll_task_t){ .root = task->root, .nfixed = task->nfixed + 1, .fixed = fixed };
+      }
     }
+    *tasks = next;
+    *ntasks = n;
+  }
+  return true;
+}
+
+/// Unroll on ctx->unroll_threads threads, results are allocated from arena.
+/// The branch limit has to be checked already.
+/// @param[out] out   same as au_unroll_flat
+static bool unroll_parallel(au_ctx_t *ctx, const token_t *toks, au_branches_t *out)
+{
+  *out = (au_branches_t){ .toks = toks };
+  au_unroll_t it;
+  if (!unroll_init(ctx, &it, toks, NULL))
+    return false;
+
+  size_t ntoks = 0;
+  size_t npush = 0;
+  size_t ntasks = 1;
+  for (; toks[ntoks].type; ++ntoks) {
+    npush += toks[ntoks].type == Push;
+    ntasks += toks[ntoks].type == Branch && toks[ntoks].lvl == 0;
   }
 
-  // parse last branch
-  ussize = 0; // clean stack
-  if (!unroll_rec(beg, 0))
-    goto fail;
+  // threads are kept for the next pattern, unless their number changes
+  size_t nthreads = ctx->unroll_threads;
+  if (ctx->pool != NULL && ctx->pool->nworkers != nthreads) {
+    pool_free(ctx->pool);
+    ctx->pool = NULL;
+  }
+  if (ctx->pool == NULL && (ctx->pool = pool_new(nthreads)) == NULL) {
+    ctx->error = "malloc";
+    return false;
+  }
 
-  // resize array for the null pointer if necessary
-  if (ures_size >= ures_cap) {
-    ++ures_cap;
-    const token_t ***nures = realloc(ures, ures_cap * sizeof(const token_t**));
-    if (nures == NULL) {
-      error = "realloc";
-      goto fail;
+  unroll_task_t *tasks = au_arena_alloc(&ctx->arena, ntasks * sizeof(unroll_task_t));
+  const token_t **choices = au_arena_alloc(&ctx->arena, nthreads * (npush + 1) * sizeof(const token_t *));
+  const token_t **bufs = au_arena_alloc(&ctx->arena, nthreads * (ntoks + 1) * sizeof(const token_t *));
+  if (tasks == NULL || choices == NULL || bufs == NULL) {
+    ctx->error = "malloc";
+    return false;
+  }
+  ntasks = 0;
+  tasks[ntasks++] = (unroll_task_t){ .root = 0 };
+  for (size_t i = 0; i < ntoks; ++i) {
+    if (toks[i].type == Branch && toks[i].lvl == 0)
+      tasks[ntasks++] = (unroll_task_t){ .root = i + 1 };
+  }
+
+  unroll_pool_t p = { &it, NULL, choices, bufs, npush, ntoks, out };
+  bool ok = unroll_split(ctx, &it, &tasks, &ntasks, nthreads * UNROLL_TASKS_PER_THREAD);
+  p.tasks = tasks;
+  if (!ok) {
+    ctx->error = "malloc";
+    goto done;
+  }
+  pool_run(ctx->pool, ntasks, unroll_task, &p);
+
+  // results of tasks after an error are dropped, like they would be
+  // if unrolling stopped there
+  size_t nbranches = 0;
+  size_t nrefs = 0;
+  size_t nused = 0;
+  while (nused < ntasks && ok) {
+    unroll_task_t *task = &tasks[nused];
+    if (task->out.offs == NULL) {
+      ctx->error = task->error;
+      ok = false;
+      break;
+    }
+    size_t n = task->out.nbranches;
+    if (nrefs + task->out.offs[n] > UINT32_MAX) {
+      // keep the branches that fit
+      while (nrefs + task->out.offs[n] > UINT32_MAX)
+        --n;
+      task->out.nbranches = n;
+      task->error = "too many branches";
     }
-    ures = nures;
+    if (task->error != NULL) {
+      ctx->error = task->error;
+      ok = false;
+    }
+    task->branch = nbranches;
+    task->ref = nrefs;
+    nbranches += n;
+    nrefs += task->out.offs[n];
+    ++nused;
   }
 
-  // write null pointer at the end
-  ures[ures_size] = NULL;
-  return ures;
+  out->offs = au_arena_alloc(&ctx->arena, (nbranches + 1) * sizeof(uint32_t));
+  out->refs = au_arena_alloc(&ctx->arena, (nrefs > 0 ? nrefs : 1) * sizeof(uint32_t));
+  if (out->offs == NULL || out->refs == NULL) {
+    *out = (au_branches_t){ .toks = toks };
+    ctx->error = "malloc";
+    ok = false;
+    goto done;
+  }
+  out->offs[nbranches] = nrefs;
+  out->nbranches = nbranches;
+  pool_run(ctx->pool, nused, unroll_merge, &p);
 
-fail:
-  for (size_t i = 0; i < ures_size; ++i)
-    free(ures[i]);
-  free(ures);
-  return NULL;
+done:
+  for (size_t i = 0; i < ntasks; ++i) {
+    free(tasks[i].out.refs);
+    free(tasks[i].out.offs);
+  }
+  return ok;
 }
 
-void free_tokens(const token_t ***toks)
+/// Unroll on multiple threads if it's worth it
+/// @param[out] parallel  set if it was
+static bool unroll_maybe_parallel(au_ctx_t *ctx, const token_t *toks, au_branches_t *out, bool *parallel)
 {
-  for (const token_t ***p = toks; *p != NULL; ++p)
-    free(*p);
-  free(toks);
+  *parallel = false;
+  // the count is only needed once, for both the limit and the threshold
+  if (ctx->unroll_threads > 1 || ctx->unroll_max != 0) {
+    size_t count;
+    if (!au_unroll_count(ctx, toks, &count) || !unroll_limit(ctx, count)) {
+      *out = (au_branches_t){ .toks = toks };
+      return false;
+    }
+    if (ctx->unroll_threads > 1 && count >= AU_UNROLL_PARALLEL_MIN) {
+      *parallel = true;
+      return unroll_parallel(ctx, toks, out);
+    }
+  }
+  return unroll_scratch(ctx, toks, out);
 }
 
+bool au_unroll_flat(au_ctx_t *ctx, const token_t *toks, au_branches_t *out)
+{
+  bool parallel;
+  bool ok = unroll_maybe_parallel(ctx, toks, out, &parallel);
+  if (out->offs == NULL || parallel)
+    return ok;
 
-bool match_autocmd(const char *str)
+  size_t nrefs = out->offs[out->nbranches];
+  uint32_t *offs = au_arena_alloc(&ctx->arena, (out->nbranches + 1) * sizeof(uint32_t));
+  uint32_t *refs = au_arena_alloc(&ctx->arena, (nrefs > 0 ? nrefs : 1) * sizeof(uint32_t));
+  if (offs == NULL || refs == NULL) {
+    *out = (au_branches_t){ .toks = toks };
+    ctx->error = "malloc";
+    return false;
+  }
+  memcpy(offs, out->offs, (out->nbranches + 1) * sizeof(uint32_t));
+  if (nrefs > 0)
+    memcpy(refs, out->refs, nrefs * sizeof(uint32_t));
+  out->offs = offs;
+  out->refs = refs;
+  return ok;
+}
+
+const token_t ***au_branches_expand(au_arena_t *arena, const au_branches_t *br, const token_t *toks)
+{
+  // pointers to branches, followed by null terminated branches
+  size_t nrefs = br->offs[br->nbranches];
+  const token_t ***res = au_arena_alloc(arena, (br->nbranches + 1) * sizeof(const token_t **)
+      + (nrefs + br->nbranches) * sizeof(const token_t *));
+  if (res == NULL)
+    return NULL;
+  const token_t **p = (const token_t **)(res + br->nbranches + 1);
+  for (size_t i = 0; i < br->nbranches; ++i) {
+    res[i] = p;
+    for (uint32_t k = br->offs[i]; k < br->offs[i + 1]; ++k)
+      *p++ = &toks[br->refs[k]];
+    *p++ = NULL;
+  }
+  res[br->nbranches] = NULL;
+  return res;
+}
+
+const token_t ***unroll(au_ctx_t *ctx, const token_t *toks)
+{
+  // expanded straight from the scratch arrays
+  au_branches_t br;
+  bool parallel;
+  if (!unroll_maybe_parallel(ctx, toks, &br, &parallel))
+    return NULL;
+  const token_t ***res = au_branches_expand(&ctx->arena, &br, toks);
+  if (res == NULL)
+    ctx->error = "malloc";
+  return res;
+}
+
+bool au_unroll_dag(au_ctx_t *ctx, const token_t *toks, au_dag_t *out)
 {
-  if (str[0] != 'a' || str[1] != 'u')
+  if (!toks->type) {
+    ctx->error = "pattern is empty";
     return false;
-  if (str[2] == '\0' || (str[2] == '!' && str[3] == '\0'))
-    return true;
-  for (size_t i = 2; i < sizeof("autocmd"); ++i) {
-    if (str[i] != "autocmd"[i])
-      return false;
-    if (str[i + 1] == '\0' || (str[i + 1] == '!' && str[i + 2] == '\0'))
-      return true;
   }
-  return false;
+
+  size_t n = 0;
+  size_t npush = 0;
+  for (; toks[n].type; ++n)
+    npush += toks[n].type == Push;
+
+  // sequences and groups are written out when they end, so the ones
+  // nested in them come first. until then their items and alternatives
+  // wait on stacks, and what's left on the stacks belongs to outer ones
+  struct { uint32_t items, seqs; } *frames;
+  uint32_t *istack;
+  au_dag_seq_t *sstack;
+  *out = (au_dag_t){ .toks = toks };
+  if ((out->items = au_arena_alloc(&ctx->arena, n * sizeof(uint32_t))) == NULL
+      || (out->seqs = au_arena_alloc(&ctx->arena, (n + 1) * sizeof(au_dag_seq_t))) == NULL
+      || (out->groups = au_arena_alloc(&ctx->arena, (npush + 1) * sizeof(au_dag_group_t))) == NULL
+      || (istack = au_arena_alloc(&ctx->arena, n * sizeof(uint32_t))) == NULL
+      || (sstack = au_arena_alloc(&ctx->arena, (n + 1) * sizeof(au_dag_seq_t))) == NULL
+      || (frames = au_arena_alloc(&ctx->arena, (npush + 1) * sizeof(*frames))) == NULL) {
+    ctx->error = "malloc";
+    return false;
+  }
+
+  size_t ni = 0;  // items on the stack
+  size_t ns = 0;  // sequences on the stack
+  size_t depth = 0;
+  frames[0].items = frames[0].seqs = 0;
+  for (const token_t *t = toks;; ++t) {
+    if (t->type == Push) {
+      // group item is filled in when the group ends
+      istack[ni++] = 0;
+      ++depth;
+      frames[depth].items = ni;
+      frames[depth].seqs = ns;
+      continue;
+    }
+    if (t->type != Branch && t->type != Pop && t->type != End) {
+      if (t->type != Empty)
+        istack[ni++] = t - toks;
+      continue;
+    }
+
+    // end of an alternative. empty root level branches don't produce anything
+    au_dag_seq_t seq = { out->nitems, ni - frames[depth].items };
+    memcpy(out->items + out->nitems, istack + frames[depth].items, seq.nitems * sizeof(uint32_t));
+    out->nitems += seq.nitems;
+    ni = frames[depth].items;
+    if (depth > 0 || seq.nitems > 0)
+      sstack[ns++] = seq;
+    if (t->type == Branch)
+      continue;
+
+    // end of a group
+    au_dag_group_t group = { out->nseqs, ns - frames[depth].seqs };
+    memcpy(out->seqs + out->nseqs, sstack + frames[depth].seqs, group.nseqs * sizeof(au_dag_seq_t));
+    out->nseqs += group.nseqs;
+    ns = frames[depth].seqs;
+    out->groups[out->ngroups] = group;
+    if (t->type == End)
+      break;
+    --depth;
+    istack[ni - 1] = AU_DAG_GROUP | out->ngroups++;
+  }
+  ++out->ngroups;
+  return true;
+}
+
+bool match_autocmd(const char *str, size_t len)
+{
+  if (len > 0 && str[len - 1] == '!')
+    --len;
+  return len >= 2 && len <= sizeof("autocmd") - 1 && memcmp(str, "autocmd", len) == 0;
 }
 
-bool match_events(const char *str)
+static bool event_is(const char *str, size_t len, const char *name)
 {
-#define EVENT_NAME_SIZE (16)
-  char buf[EVENT_NAME_SIZE] = {0};
-  const char *it = str;
-  size_t i;
+  return strlen(name) == len && strncasecmp(str, name, len) == 0;
+}
 
+bool match_events(const char *str, size_t len)
+{
+  const char *end = str + len;
   bool bufnewfile = false;
   bool bufread = false;
   bool bufreadpost = false;
 
-  while (*it != '\0') {
-    for (i = 0; i < EVENT_NAME_SIZE - 1; ++i) {
-      if (it[i] == '\0' || it[i] == ',')
-        break;
-      buf[i] = tolower(it[i]);
-    }
-    buf[i] = '\0';
-
-    if (strncmp(buf, "bufnewfile", EVENT_NAME_SIZE) == 0) {
+  for (const char *it = str; it < end;) {
+    const char *comma = memchr(it, ',', end - it);
+    size_t n = (comma != NULL ? comma : end) - it;
+    if (event_is(it, n, "bufnewfile")) {
       bufnewfile = true;
-    } else if (strncmp(buf, "bufread", EVENT_NAME_SIZE) == 0) {
+    } else if (event_is(it, n, "bufread")) {
       bufread = true;
-    } else if (strncmp(buf, "bufreadpost", EVENT_NAME_SIZE) == 0) {
+    } else if (event_is(it, n, "bufreadpost")) {
       bufreadpost = true;
     }
-
-    if (it[i] == '\0')
+    if (comma == NULL)
       break;
-    it += i + 1;
+    it = comma + 1;
   }
 
   return bufnewfile && (bufread || bufreadpost);
 }
 
+/// @return     pointer to the first character that has to be escaped
+///             in a JSON string, or end
+static const char *skip_unescaped(const char *it, const char *end)
+{
+#if defined(__AVX2__)
+  const __m256i quote = _mm256_set1_epi8('"'), bslash = _mm256_set1_epi8('\\');
+  const __m256i ctrl = _mm256_set1_epi8(0x1F);
+  for (; end - it >= 32; it += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)it);
+    __m256i m = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, bslash)),
+        _mm256_cmpeq_epi8(_mm256_max_epu8(v, ctrl), ctrl));
+    uint32_t mask = _mm256_movemask_epi8(m);
+    if (mask != 0)
+      return it + __builtin_ctz(mask);
+  }
+#endif
+#if defined(__SSE2__)
+  const __m128i squote = _mm_set1_epi8('"'), sbslash = _mm_set1_epi8('\\');
+  const __m128i sctrl = _mm_set1_epi8(0x1F);
+  for (; end - it >= 16; it += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)it);
+    __m128i m = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, squote), _mm_cmpeq_epi8(v, sbslash)),
+        _mm_cmpeq_epi8(_mm_max_epu8(v, sctrl), sctrl));
+    uint32_t mask = _mm_movemask_epi8(m);
+    if (mask != 0)
+      return it + __builtin_ctz(mask);
+  }
+#endif
+  while (it < end && *it != '"' && *it != '\\' && (uint8_t)*it >= 0x20)
+    ++it;
+  return it;
+}
+
+/// Longest escape sequence, \u00XX
+#define ESCAPE_MAX (6)
+
+/// Write escape sequence for character found by skip_unescaped
+/// @return     escape sequence length
+static size_t escape_char(char *out, char c)
+{
+  static const char hex[] = "0123456789abcdef";
+  out[0] = '\\';
+  switch (c) {
+    case '"': out[1] = '"'; return 2;
+    case '\\': out[1] = '\\'; return 2;
+    case '\b': out[1] = 'b'; return 2;
+    case '\f': out[1] = 'f'; return 2;
+    case '\n': out[1] = 'n'; return 2;
+    case '\r': out[1] = 'r'; return 2;
+    case '\t': out[1] = 't'; return 2;
+  }
+  out[1] = 'u';
+  out[2] = '0';
+  out[3] = '0';
+  out[4] = hex[(uint8_t)c >> 4];
+  out[5] = hex[(uint8_t)c & 0xF];
+  return ESCAPE_MAX;
+}
 
 int write_escaped(char *out, size_t max, const char *str, size_t len)
 {
+  const char *end = str + len;
   size_t n = 0;
-  for (size_t i = 0; i < len; ++i) {
-    char c = str[i];
-    if (c == '\\' || c == '"') {
-      if (n + 1 >= max - 1) {
-        fprintf(stderr, "value too long\n");
-        return -1;
-      }
-      out[n++] = '\\';
-    }
-    if (n + 1 >= max - 1) {
-      fprintf(stderr, "value too long\n");
+  for (const char *it = str; it < end;) {
+    const char *seg = it;
+    it = skip_unescaped(it, end);
+    if (n + (it - seg) >= max)
       return -1;
-    }
-    out[n++] = str[i];
+    memcpy(out + n, seg, it - seg);
+    n += it - seg;
+    if (it == end)
+      break;
+    char tmp[ESCAPE_MAX];
+    size_t elen = escape_char(tmp, *it++);
+    if (n + elen >= max)
+      return -1;
+    memcpy(out + n, tmp, elen);
+    n += elen;
   }
   out[n] = '\0';
   return n;
 }
+
+
+bool au_buf_reserve(au_buf_t *buf, size_t n)
+{
+  if (buf->failed)
+    return false;
+  if (buf->cap - buf->size >= n)
+    return true;
+  size_t ncap = buf->cap ? buf->cap : 4096;
+  while (ncap - buf->size < n)
+    ncap *= 2;
+  char *ndata = realloc(buf->data, ncap);
+  if (ndata == NULL) {
+    buf->failed = true;
+    return false;
+  }
+  buf->data = ndata;
+  buf->cap = ncap;
+  return true;
+}
+
+void au_buf_put(au_buf_t *buf, const char *str, size_t len)
+{
+  // data can be NULL for empty strings
+  if (len == 0)
+    return;
+  if (!au_buf_reserve(buf, len))
+    return;
+  memcpy(buf->data + buf->size, str, len);
+  buf->size += len;
+}
+
+void au_buf_puts(au_buf_t *buf, const char *str)
+{
+  au_buf_put(buf, str, strlen(str));
+}
+
+void au_buf_putc(au_buf_t *buf, char c)
+{
+  if (!au_buf_reserve(buf, 1))
+    return;
+  buf->data[buf->size++] = c;
+}
+
+void au_buf_pad(au_buf_t *buf, size_t n)
+{
+  if (!au_buf_reserve(buf, n))
+    return;
+  memset(buf->data + buf->size, ' ', n);
+  buf->size += n;
+}
+
+void au_buf_putu(au_buf_t *buf, size_t num)
+{
+  char tmp[24];
+  size_t n = sizeof(tmp);
+  do {
+    tmp[--n] = '0' + num % 10;
+    num /= 10;
+  } while (num != 0);
+  au_buf_put(buf, tmp + n, sizeof(tmp) - n);
+}
+
+void au_buf_escape(au_buf_t *buf, const char *str, size_t len)
+{
+  const char *end = str + len;
+  if (!au_buf_reserve(buf, len))
+    return;
+  for (const char *it = str; it < end;) {
+    // clean runs are copied as they are, room for them is reserved
+    // up front, and again after every escape sequence
+    const char *seg = it;
+    it = skip_unescaped(it, end);
+    memcpy(buf->data + buf->size, seg, it - seg);
+    buf->size += it - seg;
+    if (it == end)
+      break;
+    if (!au_buf_reserve(buf, ESCAPE_MAX + (end - it)))
+      return;
+    buf->size += escape_char(buf->data + buf->size, *it++);
+  }
+}
+
+bool au_buf_flush(au_buf_t *buf, int fd)
+{
+  if (buf->failed)
+    return false;
+  for (size_t n = 0; n < buf->size;) {
+    ssize_t r = write(fd, buf->data + n, buf->size - n);
+    if (r < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    n += r;
+  }
+  buf->size = 0;
+  return true;
+}
+
+void au_buf_free(au_buf_t *buf)
+{
+  free(buf->data);
+  memset(buf, 0, sizeof(au_buf_t));
+}
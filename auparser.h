@@ -2,6 +2,7 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef enum {
   End = 0,      /// internal, end of tokens
@@ -23,15 +24,66 @@ typedef enum {
 
 const char *type_str(type_t type);
 
-extern const char *error;
-
+/// Token, 16 bytes. Patterns are limited to 4GB and 65535 nested groups,
+/// au_bin_token_t is the position independent form.
 typedef struct token {
-  type_t type;      /// token type
   const char *beg;  /// where it begins in string
-  size_t len;       /// length of string
-  int lvl;          /// nest level for branches
+  uint32_t len;     /// length of string
+  uint16_t lvl;     /// nest level for branches
+  uint8_t type;     /// token type, type_t
 } token_t;
 
+/// Bump allocator. Memory is handed out from large chunks and released
+/// all at once. It's kept around and reused after a reset.
+typedef struct {
+  struct au_chunk *head;  /// first chunk
+  struct au_chunk *cur;   /// chunk currently allocated from
+  char *ptr;              /// next free byte in the current chunk
+  char *end;              /// end of the current chunk
+  size_t size;            /// total size of all chunks
+} au_arena_t;
+
+/// Allocate from arena, aligned for any type
+/// @return     NULL if memory allocation failed
+void *au_arena_alloc(au_arena_t *arena, size_t size);
+/// Resize allocation. If it was the last one it's resized in place,
+/// otherwise it's copied to a new allocation.
+/// @param[in]  ptr     previous allocation, can be NULL
+/// @param[in]  old     previous allocation size
+/// @param[in]  size    new size
+/// @return     NULL if memory allocation failed, ptr stays valid
+void *au_arena_realloc(au_arena_t *arena, void *ptr, size_t old, size_t size);
+/// Release everything allocated from arena. Memory is kept for reuse.
+void au_arena_reset(au_arena_t *arena);
+/// Free all memory owned by arena
+void au_arena_free(au_arena_t *arena);
+
+/// Threads that unroll big patterns, see au_ctx_t
+typedef struct au_pool au_pool_t;
+
+/// Parser context, holds all state used by tokenize and unroll.
+/// Each thread needs its own context.
+typedef struct {
+  const char *error;                    /// error message of the last failure
+  au_arena_t arena;                     /// owns tokens and unroll results
+  size_t unroll_max;                    /// max number of unrolled branches, 0 for no limit
+  size_t unroll_threads;                /// threads to unroll big patterns with, 0 or 1 for
+                                        /// the calling thread only, see AU_UNROLL_PARALLEL_MIN
+  uint32_t *refs;                       /// unroll results in progress, see au_branches_t
+  size_t refs_cap;
+  uint32_t *offs;
+  size_t offs_cap;
+  au_pool_t *pool;                      /// unroll_threads threads, started when first
+                                        /// needed and kept until au_ctx_free
+} au_ctx_t;
+
+/// Initialize parser context
+void au_ctx_init(au_ctx_t *ctx);
+/// Release all tokens and unroll results allocated with this context
+void au_ctx_reset(au_ctx_t *ctx);
+/// Free all memory owned by context
+void au_ctx_free(au_ctx_t *ctx);
+
 /// Print internal representation of a single token
 /// @param[in]  tok     token
 void print_token(const token_t *tok);
@@ -40,27 +92,479 @@ void print_token(const token_t *tok);
 void print_tokens(const token_t **toks);
 
 /// Tokenize pattern
+/// @param[in]  ctx   parser context, error is set on failure
 /// @param[in]  pat   pattern to tokenize
-/// @return     allocated array of tokens
-token_t *tokenize(const char *pat);
+/// @return     array of tokens, valid until au_ctx_reset
+token_t *tokenize(au_ctx_t *ctx, const char *pat);
+/// Tokenize pattern that isn't null terminated, tokens point into it
+/// @param[in]  len   pattern length
+token_t *tokenize_n(au_ctx_t *ctx, const char *pat, size_t len);
+
+/// Where alternatives of a group end, for Push and Branch tokens
+typedef struct {
+  uint32_t next;      /// index of the next Branch or Pop of the same group
+  uint32_t pop;       /// index of the Pop that closes the group
+} au_jump_t;
 
-/// Unroll pattern
+/// Tokenize pattern, and link groups so that walking the tokens can go
+/// straight to the next alternative or past the group
+/// @param[out] jumps   for every token, only set for Push and Branch,
+///                     valid until au_ctx_reset
+token_t *tokenize_jumps(au_ctx_t *ctx, const char *pat, size_t len, au_jump_t **jumps);
+
+/// Unroll pattern. Fails without unrolling anything if there would be
+/// more than ctx->unroll_max branches.
+/// @param[in]  ctx    parser context, error is set on failure
 /// @param[in]  toks   token array
-/// @return     null terminated array of token_t* arrays
-const token_t ***unroll(const token_t *toks);
-/// Free array allocated by unroll
-void free_tokens(const token_t ***toks);
+/// @return     null terminated array of token_t* arrays,
+///             valid until au_ctx_reset
+const token_t ***unroll(au_ctx_t *ctx, const token_t *toks);
+
+/// Unrolled branches in compressed sparse row form. Tokens of branch i
+/// are toks[refs[k]] for every k from offs[i] up to offs[i + 1].
+typedef struct {
+  const token_t *toks;  /// tokens the branches refer to
+  uint32_t *refs;       /// token indexes of all branches, one after another
+  uint32_t *offs;       /// where branches start in refs, nbranches + 1 entries
+  size_t nbranches;
+} au_branches_t;
+
+/// Patterns with at least this many branches are unrolled in parallel
+/// by unroll and au_unroll_flat when ctx->unroll_threads is set. Root
+/// level branches and the alternatives of groups at their start are
+/// split between threads, and the results are merged in order, so they
+/// are the same as from a single thread.
+#define AU_UNROLL_PARALLEL_MIN (4096)
+
+/// Unroll pattern into a flat list of branches, same as unroll
+/// @param[in]  ctx    parser context, error is set on failure
+/// @param[in]  toks   token array
+/// @param[out] out    branches, valid until au_ctx_reset. On failure offs
+///                    is NULL if nothing was unrolled, otherwise it holds
+///                    the branches before the error
+/// @return     false on error
+bool au_unroll_flat(au_ctx_t *ctx, const token_t *toks, au_branches_t *out);
+/// Convert branches to the form returned by unroll, in one allocation
+/// @param[in]  arena  allocated from
+/// @param[in]  br     branches
+/// @param[in]  toks   tokens to point to, br->toks or a copy of them
+/// @return     NULL if memory allocation failed
+const token_t ***au_branches_expand(au_arena_t *arena, const au_branches_t *br, const token_t *toks);
+
+/// Item of a factorized sequence is a group index with this bit set,
+/// a token index otherwise
+#define AU_DAG_GROUP (1u << 31)
+
+/// Range of items that make up a sequence
+typedef struct {
+  uint32_t items;     /// first item
+  uint32_t nitems;
+} au_dag_seq_t;
+
+/// Range of sequences that are alternatives of a group
+typedef struct {
+  uint32_t seqs;      /// first sequence
+  uint32_t nseqs;
+} au_dag_group_t;
+
+/// Unroll result that keeps groups shared instead of expanding every
+/// combination of them, so its size is linear in the pattern. Branches
+/// unroll would produce are the paths through it, in the same order:
+/// branches of a sequence are every combination of branches of its items,
+/// branches of a group are branches of its alternatives one after another.
+/// Inner groups come before outer ones, the root is the last group and its
+/// alternatives are the root level branches that aren't empty. Empty tokens
+/// are left out.
+typedef struct {
+  const token_t *toks;    /// tokens the items refer to
+  uint32_t *items;        /// token index, or group index with AU_DAG_GROUP
+  au_dag_seq_t *seqs;
+  au_dag_group_t *groups;
+  size_t nitems;
+  size_t nseqs;
+  size_t ngroups;         /// root included
+} au_dag_t;
+
+/// Unroll pattern into factorized form. Nothing is expanded, so there are
+/// no limits on nesting, branch length or number of branches.
+/// @param[in]  ctx    parser context, error is set on failure
+/// @param[in]  toks   token array
+/// @param[out] out    result, valid until au_ctx_reset
+/// @return     false on error
+bool au_unroll_dag(au_ctx_t *ctx, const token_t *toks, au_dag_t *out);
+
+/// Count branches unroll would produce, in a single pass over tokens
+/// @param[in]  ctx    parser context, error is set on failure
+/// @param[in]  toks   token array
+/// @param[out] count  number of branches, SIZE_MAX if it doesn't fit
+/// @return     false on error
+bool au_unroll_count(au_ctx_t *ctx, const token_t *toks, size_t *count);
+
+/// Unroll iterator, produces branches one at a time in the same order
+/// as unroll, without keeping them around
+typedef struct {
+  au_ctx_t *ctx;              /// error is set on failure
+  const token_t *toks;        /// token array
+  const au_jump_t *jumps;     /// for every token, only set for Push and Branch
+  const token_t *root;        /// current root level branch, NULL when done
+  const token_t *rootend;     /// Branch or End after it
+  bool started;               /// root branch produced something already
+  const token_t **choices;    /// chosen alternative for each group on the path
+  size_t nchoices;
+  size_t nfixed;              /// choices that are kept, for unrolling a part of the pattern
+  bool single;                /// stop after the current root level branch
+  const token_t **buf;        /// current branch, up to the number of tokens
+} au_unroll_t;
+
+/// Start unrolling pattern, same limits as for unroll apply
+/// @param[in]  ctx   parser context, error is set on failure. it's used
+///                   for allocations, so the iterator is valid until au_ctx_reset
+/// @param[out] it    iterator
+/// @param[in]  toks  token array
+/// @return     false on error
+bool au_unroll_init(au_ctx_t *ctx, au_unroll_t *it, const token_t *toks);
+/// Start unrolling pattern with groups linked by tokenize_jumps
+/// @param[in]  jumps jumps for toks, made here if NULL
+bool au_unroll_init_jumps(au_ctx_t *ctx, au_unroll_t *it, const token_t *toks, const au_jump_t *jumps);
+/// Get next branch
+/// @param[in]  it    iterator
+/// @param[out] out   null terminated array of tokens, valid until the next
+///                   call. NULL when there are no more branches
+/// @return     false on error
+bool au_unroll_next(au_unroll_t *it, const token_t ***out);
+
+/// Cached tokenize and unroll results of a pattern
+typedef struct {
+  const char *pat;            /// copy of the pattern, null terminated
+  size_t patlen;
+  uint64_t hash;
+  const token_t *toks;        /// tokens pointing into pat, NULL if tokenizing failed
+  const token_t ***res;       /// null terminated unroll result, NULL if not unrolled
+  size_t nres;                /// number of branches in res
+  bool unrolled;              /// unroll was attempted
+  const char *error;          /// tokenize or unroll error. if unrolling failed
+                              /// after it started, res has branches before the error
+  const char *data;           /// data attached with au_cache_set_data, eg. rendered output
+  size_t size;
+} au_cache_entry_t;
+
+/// Bump this when tokenize or unroll results change, stored results
+/// from other versions aren't used
+#define AU_PARSER_VERSION (1)
+
+typedef struct au_store au_store_t;
+
+/// Memoized tokenize and unroll results, keyed on pattern text. Entries
+/// are kept until the cache is freed. Not thread safe.
+typedef struct {
+  au_arena_t arena;           /// owns entries, tokens and unroll results
+  au_cache_entry_t **slots;
+  size_t cap;
+  size_t size;                /// number of entries
+  size_t hits;
+  size_t misses;
+  size_t loaded;              /// misses found in store
+  const au_store_t *store;    /// results from previous runs, can be NULL.
+                              /// has to stay open until the cache is freed
+} au_cache_t;
+
+/// Initialize cache
+void au_cache_init(au_cache_t *cache);
+/// Free all memory owned by cache
+void au_cache_free(au_cache_t *cache);
+/// Get tokens and optionally unroll result of a pattern, tokenizing and
+/// unrolling it if it's not cached yet. Errors are cached too.
+/// @param[in]  ctx     parser context, used for temporary allocations
+/// @param[in]  pat     pattern, doesn't have to be null terminated
+/// @param[in]  len     pattern length
+/// @param[in]  unroll  unroll the pattern
+/// @return     entry valid until au_cache_free, NULL if memory allocation failed
+const au_cache_entry_t *au_cache_get(au_ctx_t *ctx, au_cache_t *cache,
+    const char *pat, size_t len, bool unroll);
+/// Attach a copy of data to entry, replacing the previous one
+/// @return     false if memory allocation failed
+bool au_cache_set_data(au_cache_t *cache, const au_cache_entry_t *entry, const char *data, size_t size);
+
+/// Compiled pattern
+typedef struct au_prog au_prog_t;
+
+/// Compile tokenized pattern for matching file paths
+/// @param[in]  ctx     parser context, error is set on failure
+/// @param[in]  toks    token array
+/// @return     allocated program, NULL on error
+au_prog_t *au_compile(au_ctx_t *ctx, const token_t *toks);
+/// Free program allocated by au_compile
+void au_free_prog(au_prog_t *prog);
+/// Match file path against compiled pattern. Like in vim, patterns
+/// without a '/' are matched against the tail of the path too.
+/// @param[in]  prog    compiled pattern
+/// @param[in]  path    file path
+/// @param[in]  len     file path length
+/// @return     false if it didn't match or memory allocation failed
+bool au_match(const au_prog_t *prog, const char *path, size_t len);
+
+/// Pattern set entry, reported on matches
+typedef struct {
+  size_t lnum;      /// source line number
+  const char *cmd;  /// autocmd command
+} au_rule_t;
+
+/// Set of compiled patterns, matched all at once
+typedef struct au_set au_set_t;
+
+/// Create empty pattern set
+au_set_t *au_set_new(void);
+/// Free pattern set
+void au_set_free(au_set_t *set);
+/// Add pattern to the set. Patterns added earlier take priority,
+/// the same way autocmds are executed in the order they're defined.
+/// @param[in]  ctx     parser context, error is set on failure
+/// @param[in]  set     pattern set
+/// @param[in]  toks    token array
+/// @param[in]  lnum    source line number
+/// @param[in]  cmd     autocmd command, copied. can be NULL
+/// @return     false on error
+bool au_set_add(au_ctx_t *ctx, au_set_t *set, const token_t *toks, size_t lnum, const char *cmd);
+/// Number of patterns in the set
+size_t au_set_size(const au_set_t *set);
+/// Match file path against every pattern in the set, in a single pass.
+/// The automaton is built lazily, so the set is modified and can't be
+/// shared between threads.
+/// @param[in]  set     pattern set
+/// @param[in]  path    file path
+/// @param[in]  len     file path length
+/// @return     first pattern that matched, NULL if none did or
+///             memory allocation failed
+const au_rule_t *au_set_match(au_set_t *set, const char *path, size_t len);
+/// Match file path against the set without the automaton. A single scan
+/// over the path finds patterns whose required literals are in it, eg.
+/// ".json" in "*.json", and only those patterns are run. The prefilter
+/// is built lazily, so the same rules as for au_set_match apply.
+/// @return     first pattern that matched, NULL if none did
+const au_rule_t *au_set_match_prefiltered(au_set_t *set, const char *path, size_t len);
 
 /// Match autocommand name. in vim regex: "au%[utocmd]!?"
-bool match_autocmd(const char *str);
-/// Match event names. BufNewFile and BufRead/BufReadPost
-bool match_events(const char *str);
+bool match_autocmd(const char *str, size_t len);
+/// Match comma separated event names. BufNewFile and BufRead/BufReadPost
+bool match_events(const char *str, size_t len);
+
+
+/// Growable output buffer. Allocation failures are sticky, everything
+/// written after one is dropped and reported when flushing.
+typedef struct {
+  char *data;   /// buffer contents, not null terminated
+  size_t size;  /// length of contents
+  size_t cap;   /// allocated size
+  bool failed;  /// memory allocation failed
+} au_buf_t;
 
+/// Make room for at least n more bytes
+/// @return     false if memory allocation failed
+bool au_buf_reserve(au_buf_t *buf, size_t n);
+/// Append bytes
+void au_buf_put(au_buf_t *buf, const char *str, size_t len);
+/// Append null terminated string
+void au_buf_puts(au_buf_t *buf, const char *str);
+/// Append single character
+void au_buf_putc(au_buf_t *buf, char c);
+/// Append n spaces
+void au_buf_pad(au_buf_t *buf, size_t n);
+/// Append unsigned number in decimal
+void au_buf_putu(au_buf_t *buf, size_t num);
+/// Append string escaped for JSON, control characters included
+void au_buf_escape(au_buf_t *buf, const char *str, size_t len);
+/// Write contents to file descriptor and clear buffer
+/// @return     false on write error, or if memory allocation failed before
+bool au_buf_flush(au_buf_t *buf, int fd);
+/// Free buffer
+void au_buf_free(au_buf_t *buf);
 
-/// Writes escaped string
+/// Writes string escaped for JSON, same as au_buf_escape
 /// @param[out] out   output buffer
 /// @param[in]  max   output buffer max size
 /// @param[in]  str   string to escape
 /// @param[in]  len   string length
-/// @return     number of bytes written
+/// @return     number of bytes written, -1 if it didn't fit. nothing is
+///             printed, the caller reports it
 int write_escaped(char *out, size_t max, const char *str, size_t len);
+
+
+// Binary output format. All integers are in host byte order, every
+// section starts at a 4 byte aligned offset. After the header come:
+//
+//   au_bin_pattern_t  patterns[npatterns]
+//   au_bin_token_t    tokens[ntokens]
+//   au_bin_branch_t   branches[nbranches]
+//   uint32_t          refs[nrefs]
+//   au_dag_group_t    groups[ngroups]
+//   au_dag_seq_t      seqs[nseqs]
+//   uint32_t          items[nitems]
+//   char              strings[strsize]
+//
+// Tokens of a pattern are a range in tokens, unrolled branches of a
+// pattern are a range in branches, and every branch is a range in refs,
+// which are indexes into tokens. Token values are ranges in strings,
+// inside of the pattern they come from.
+//
+// Factorized form of a pattern (see au_dag_t) is a range in groups, the
+// last one is the root. Groups are ranges in seqs, seqs are ranges in
+// items, and items are indexes into tokens, or into groups with
+// AU_DAG_GROUP set.
+
+#define AU_BIN_MAGIC "AUPB"
+#define AU_BIN_VERSION (3)
+/// Offset of a missing string
+#define AU_BIN_NONE (UINT32_MAX)
+
+typedef struct {
+  char magic[4];      /// AU_BIN_MAGIC
+  uint32_t version;   /// AU_BIN_VERSION
+  uint32_t parser;    /// AU_PARSER_VERSION of the parser that wrote it
+  uint32_t npatterns;
+  uint32_t ntokens;
+  uint32_t nbranches;
+  uint32_t nrefs;
+  uint32_t ngroups;
+  uint32_t nseqs;
+  uint32_t nitems;
+  uint32_t strsize;
+} au_bin_header_t;
+
+/// Range in the string table
+typedef struct {
+  uint32_t off;       /// AU_BIN_NONE if missing
+  uint32_t len;
+} au_bin_str_t;
+
+typedef struct {
+  au_bin_str_t pattern;
+  au_bin_str_t cmd;
+  au_bin_str_t file;
+  au_bin_str_t error;
+  uint32_t lnum;      /// 0 if unknown
+  uint32_t tokens;    /// first token
+  uint32_t ntokens;   /// number of tokens, End isn't included
+  uint32_t branches;  /// first branch
+  uint32_t nbranches; /// number of branches, 0 if not unrolled
+  uint32_t groups;    /// first group of the factorized form
+  uint32_t ngroups;   /// number of groups, 0 if not factorized
+  uint32_t flags;     /// AU_BIN_UNROLLED, AU_BIN_FACTORIZED
+} au_bin_pattern_t;
+
+/// Pattern was unrolled, branches before an unroll error are kept
+#define AU_BIN_UNROLLED (1u << 0)
+/// Pattern was unrolled into factorized form
+#define AU_BIN_FACTORIZED (1u << 1)
+
+typedef struct {
+  uint8_t type;       /// type_t
+  uint8_t reserved;
+  uint16_t lvl;
+  au_bin_str_t value;
+} au_bin_token_t;
+
+typedef struct {
+  uint32_t refs;      /// first token index in refs
+  uint32_t nrefs;
+} au_bin_branch_t;
+
+/// Binary format writer, sections are collected separately
+typedef struct {
+  au_buf_t patterns;
+  au_buf_t tokens;
+  au_buf_t branches;
+  au_buf_t refs;
+  au_buf_t groups;
+  au_buf_t seqs;
+  au_buf_t items;
+  au_buf_t strings;
+  const char *file;   /// file name that was written last
+  uint32_t fileoff;   /// and where it was written
+} au_bin_writer_t;
+
+/// Pattern and where it came from
+typedef struct {
+  const char *pat;
+  size_t patlen;
+  const char *cmd;    /// can be NULL
+  size_t cmdlen;
+  const char *file;   /// null terminated, can be NULL
+  size_t lnum;
+} au_bin_source_t;
+
+/// Tokenize pattern, optionally unroll it, and add everything to writer.
+/// Errors are recorded for the pattern, same as in the JSON output.
+/// @param[in]  ctx     parser context, error is set on failure
+/// @param[in]  w       writer, zero initialized before first use
+/// @param[in]  src     pattern
+/// @param[in]  flags   AU_BIN_UNROLLED to add unrolled branches,
+///                     AU_BIN_FACTORIZED to add the factorized form
+/// @return     false if the pattern has an error
+bool au_bin_add(au_ctx_t *ctx, au_bin_writer_t *w, const au_bin_source_t *src, uint32_t flags);
+/// Move everything from src to the end of dst. src is cleared.
+void au_bin_append(au_bin_writer_t *dst, au_bin_writer_t *src);
+/// Copy everything from src to the end of dst, src is left as it is
+void au_bin_append_copy(au_bin_writer_t *dst, const au_bin_writer_t *src);
+/// Write binary file into buffer
+/// @return     false if memory allocation failed, or it doesn't fit in 32-bit offsets
+bool au_bin_finish(au_bin_writer_t *w, au_buf_t *out);
+/// Free writer
+void au_bin_free(au_bin_writer_t *w);
+
+/// Binary file, pointers into the file contents
+typedef struct {
+  const au_bin_header_t *header;
+  const au_bin_pattern_t *patterns;
+  const au_bin_token_t *tokens;
+  const au_bin_branch_t *branches;
+  const uint32_t *refs;
+  const au_dag_group_t *groups;
+  const au_dag_seq_t *seqs;
+  const uint32_t *items;
+  const char *strings;
+} au_bin_t;
+
+/// Open binary file from memory, eg. mmap'd. Nothing is copied, every
+/// record is checked to be in bounds, so the file can be used as is.
+/// @param[out] bin     binary file
+/// @param[in]  data    file contents, 4 byte aligned
+/// @param[in]  size    file size
+/// @param[out] error   error message
+/// @return     false on error
+bool au_bin_open(au_bin_t *bin, const void *data, size_t size, const char **error);
+
+/// @return     string from the string table, NULL if missing
+static inline const char *au_bin_str(const au_bin_t *bin, au_bin_str_t str)
+{
+  return str.off == AU_BIN_NONE ? NULL : bin->strings + str.off;
+}
+
+/// Add cached pattern to writer, without a command or file
+void au_bin_add_entry(au_bin_writer_t *w, const au_cache_entry_t *e);
+
+/// Results of previous runs, in the binary format. The file is mapped
+/// and entries are rebuilt from it when a cache looks them up. Read only,
+/// can be shared between threads.
+struct au_store {
+  void *data;                 /// mapped file
+  size_t size;
+  au_bin_t bin;
+  uint32_t *index;            /// pattern index + 1 by hash, 0 if empty
+  size_t cap;
+  uint64_t *hashes;           /// hash of every pattern
+};
+
+/// Add cache entries to writer, to be opened with au_store_open later.
+/// Every entry is written, including ones loaded from the store, so the
+/// result replaces the previous store file. Entries that were stored
+/// without branches have them once they're unrolled.
+void au_cache_save(const au_cache_t *cache, au_bin_writer_t *w);
+/// Error of au_store_open when there's no file, eg. on the first run
+#define AU_STORE_MISSING "file does not exist"
+
+/// Open file written from au_cache_save
+/// @param[out] error   error message, AU_STORE_MISSING if there's no file
+/// @return     false on error
+bool au_store_open(au_store_t *store, const char *path, const char **error);
+/// Close store
+void au_store_close(au_store_t *store);
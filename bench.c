@@ -0,0 +1,647 @@
+// main.c is included to benchmark rendering, which isn't part of the library
+#define main auparser_main
+#include "main.c"
+#undef main
+
+#include <math.h>
+#include <time.h>
+
+#define DEFAULT_CORPUS "corpus/filetype.vim"
+
+static au_ctx_t ctx;
+
+/// Number of untimed runs before measuring
+static size_t opt_warmup = 3;
+/// Number of timed runs
+static size_t opt_repeat = 10;
+/// Minimum duration of a timed run, in ns. Fast benchmarks are repeated
+/// within a run until it takes at least this long.
+static double opt_min_time = 20e6;
+/// Benchmarks slower than this, in ns, are measured only once
+static double opt_max_time = 1e9;
+/// Threads to unroll with in the stress benchmark
+static size_t opt_threads = 1;
+
+/// Typical filetype detection patterns
+static const char *patterns[] = {
+  "*.c", "*.h", "*.cpp,*.cc,*.cxx,*.c++,*.hh,*.hxx,*.hpp",
+  "*.json", "*.jsonc", "*.js,*.javascript,*.es,*.mjs,*.cjs",
+  "*.lua", "*.vim,*.vba,.exrc,_exrc", "*.py,*.pyw,.pythonstartup,.pythonrc",
+  "*.rs", "*.go", "*.toml", "*.md,*.markdown,*.mdown,*.mkd,*.mkdn",
+  "*[mM]akefile,*.mk,*.mak,*.dsp", "Makefile.am", "CMakeLists.txt",
+  "*/etc/hosts", "*/etc/pam.conf", "*/etc/sudoers.d/*",
+  "*/.config/git/attributes", "*/etc/xdg/menus/*.menu", "*/etc/dnsmasq.d/*",
+  ".bashrc,bashrc,bash.bashrc,.bash[_-]profile,.bash[_-]logout",
+  "*.sh,*.env", "*.tex", "*.[1-9]", "*.log\\c,*_log\\c",
+  "*.{yml,yaml}", "*.html,*.htm,*.shtml,*.stm", "*.css",
+  "*.d[0-9]\\\\\\{,3\\}", "*/debian/changelog", "*.git/config",
+  "{.,}gitconfig", "*.Rnw,*.rnw,*.Snw,*.snw", "*.tf",
+  "[cC]hange[lL]og*", "*.xml", "*.patch,*.diff,*.rej",
+};
+
+/// Paths to match against
+static const char *paths[] = {
+  "/home/user/src/project/main.c",
+  "/home/user/src/project/include/parser.hpp",
+  "/home/user/.config/nvim/init.lua",
+  "/home/user/src/project/Makefile",
+  "/etc/hosts",
+  "/etc/sudoers.d/90-user",
+  "/home/user/src/project/.gitconfig",
+  "/var/log/Xorg.0.LOG",
+  "/usr/share/man/man1/ls.1",
+  "/home/user/src/project/README",
+  "/home/user/src/project/debian/changelog",
+  "/tmp/a/very/deeply/nested/directory/structure/with/no/match.zzz",
+};
+
+#define LEN(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+/// String that isn't null terminated
+typedef struct {
+  const char *str;
+  size_t len;
+} slice_t;
+
+/// Autocmds found in the corpus
+typedef struct {
+  const char *path;
+  char *data;
+  size_t size;
+  bool mapped;
+  slice_t *words;     /// first word of every line, for match_autocmd
+  size_t nwords;
+  slice_t *events;    /// events of every autocmd, for match_events
+  slice_t *pats;      /// patterns of every autocmd
+  slice_t *cmds;      /// commands of every autocmd, up to the end of line
+  size_t naus;
+} corpus_t;
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/// Timing of a benchmark, in ns per call
+typedef struct {
+  size_t items;   /// items processed in one call
+  double mean;
+  double stddev;
+  double min;
+} timing_t;
+
+/// Run fn with warmup and repetitions
+/// @param[in]  fn      benchmark, returns number of items processed in one call
+/// @param[in]  arg     argument for fn
+static timing_t measure(size_t (*fn)(void *arg), void *arg)
+{
+  // calibrate, so that a run isn't dominated by timer resolution
+  double beg = now();
+  size_t items = fn(arg);
+  double el = now() - beg;
+  if (el >= opt_max_time)
+    return (timing_t){ items, el, 0, el };
+  size_t inner = el >= opt_min_time ? 1 : (size_t)(opt_min_time / (el > 1 ? el : 1));
+  if (inner < 1)
+    inner = 1;
+
+  for (size_t i = 0; i < opt_warmup; ++i) {
+    for (size_t k = 0; k < inner; ++k)
+      fn(arg);
+  }
+
+  double sum = 0, sumsq = 0, min = INFINITY;
+  for (size_t i = 0; i < opt_repeat; ++i) {
+    beg = now();
+    for (size_t k = 0; k < inner; ++k)
+      fn(arg);
+    double t = (now() - beg) / inner;
+    sum += t;
+    sumsq += t * t;
+    min = t < min ? t : min;
+  }
+  double mean = sum / opt_repeat;
+  double var = opt_repeat > 1 ? (sumsq - sum * mean) / (opt_repeat - 1) : 0;
+  return (timing_t){ items, mean, var > 0 ? sqrt(var) : 0, min };
+}
+
+/// Run fn with warmup and repetitions, and print statistics
+/// @param[in]  name    benchmark name
+/// @param[in]  fn      benchmark, returns number of items processed in one call
+/// @param[in]  arg     argument for fn
+/// @param[in]  bytes   bytes processed in one call, 0 if not applicable
+static void run(const char *name, size_t (*fn)(void *arg), void *arg, size_t bytes)
+{
+  timing_t t = measure(fn, arg);
+  size_t items = t.items;
+  double mean = t.mean, stddev = t.stddev, min = t.min;
+
+  printf("%-28s %10.1f ns/item  ±%5.1f%%  %10.0f items/s",
+      name, mean / items, mean > 0 ? stddev / mean * 100 : 0, items / mean * 1e9);
+  if (bytes > 0)
+    printf("  %8.1f MB/s", bytes / mean * 1e3);
+  printf("  (min %.1f ns/item)\n", min / items);
+}
+
+/// Find autocmds in the corpus the same way main.c does, without continuation lines
+static void load_corpus(corpus_t *c, const char *path)
+{
+  memset(c, 0, sizeof(*c));
+  c->path = path;
+  if (!load_input(path, &c->data, &c->size, &c->mapped)) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  size_t cap = 0;
+  for (size_t i = 0; i < c->size; ++i)
+    cap += c->data[i] == '\n';
+  ++cap;
+  c->words = malloc(cap * sizeof(slice_t));
+  c->events = malloc(cap * sizeof(slice_t));
+  c->pats = malloc(cap * sizeof(slice_t));
+  c->cmds = malloc(cap * sizeof(slice_t));
+  assert(c->words && c->events && c->pats && c->cmds);
+
+  const char *end = c->data + c->size;
+  for (const char *next = c->data; next < end;) {
+    const char *it = next;
+    const char *eol = memchr(it, '\n', end - it);
+    eol = eol != NULL ? eol : end;
+    next = eol < end ? eol + 1 : end;
+
+    it = skip_space(it, eol);
+    const char *word = it;
+    it = skip_to_space(it, eol);
+    if (it == word)
+      continue;
+    c->words[c->nwords++] = (slice_t){ word, it - word };
+    if (!match_autocmd(word, it - word))
+      continue;
+
+    it = skip_space(it, eol);
+    const char *events = it;
+    it = skip_to_space(it, eol);
+    if (it == events || !match_events(events, it - events))
+      continue;
+    it = skip_space(it, eol);
+    const char *pat = it;
+    it = skip_to_space(it, eol);
+    if (it == pat)
+      continue;
+    const char *cmd = skip_space(it, eol);
+    c->events[c->naus] = (slice_t){ events, skip_to_space(events, eol) - events };
+    c->pats[c->naus] = (slice_t){ pat, it - pat };
+    c->cmds[c->naus] = (slice_t){ cmd, eol - cmd };
+    ++c->naus;
+  }
+}
+
+static void free_corpus(corpus_t *c)
+{
+  if (c->mapped)
+    munmap(c->data, c->size);
+  else
+    free(c->data);
+  free(c->words);
+  free(c->events);
+  free(c->pats);
+  free(c->cmds);
+}
+
+static size_t total_len(const slice_t *s, size_t n)
+{
+  size_t res = 0;
+  for (size_t i = 0; i < n; ++i)
+    res += s[i].len;
+  return res;
+}
+
+typedef struct {
+  const slice_t *s;
+  size_t n;
+} slices_t;
+
+static size_t do_tokenize(void *arg)
+{
+  const slices_t *a = arg;
+  for (size_t i = 0; i < a->n; ++i) {
+    tokenize_n(&ctx, a->s[i].str, a->s[i].len);
+    au_ctx_reset(&ctx);
+  }
+  return a->n;
+}
+
+typedef struct {
+  token_t **toks;
+  size_t n;
+} unroll_arg_t;
+
+static size_t do_unroll(void *arg)
+{
+  const unroll_arg_t *a = arg;
+  for (size_t i = 0; i < a->n; ++i) {
+    if (a->toks[i] != NULL)
+      unroll(&ctx, a->toks[i]);
+    au_ctx_reset(&ctx);
+  }
+  return a->n;
+}
+
+static size_t do_unroll_flat(void *arg)
+{
+  const unroll_arg_t *a = arg;
+  au_branches_t br;
+  for (size_t i = 0; i < a->n; ++i) {
+    if (a->toks[i] != NULL)
+      au_unroll_flat(&ctx, a->toks[i], &br);
+    au_ctx_reset(&ctx);
+  }
+  return a->n;
+}
+
+static size_t do_unroll_dag(void *arg)
+{
+  const unroll_arg_t *a = arg;
+  au_dag_t dag;
+  for (size_t i = 0; i < a->n; ++i) {
+    if (a->toks[i] != NULL)
+      au_unroll_dag(&ctx, a->toks[i], &dag);
+    au_ctx_reset(&ctx);
+  }
+  return a->n;
+}
+
+static size_t do_match_autocmd(void *arg)
+{
+  const slices_t *a = arg;
+  volatile size_t matched = 0;
+  for (size_t i = 0; i < a->n; ++i)
+    matched += match_autocmd(a->s[i].str, a->s[i].len);
+  return a->n;
+}
+
+static size_t do_match_events(void *arg)
+{
+  const slices_t *a = arg;
+  volatile size_t matched = 0;
+  for (size_t i = 0; i < a->n; ++i)
+    matched += match_events(a->s[i].str, a->s[i].len);
+  return a->n;
+}
+
+typedef struct {
+  const slice_t *s;
+  size_t n;
+  char *out;
+  size_t max;
+} escape_arg_t;
+
+static size_t do_write_escaped(void *arg)
+{
+  const escape_arg_t *a = arg;
+  for (size_t i = 0; i < a->n; ++i) {
+    int r = write_escaped(a->out, a->max, a->s[i].str, a->s[i].len);
+    assert(r >= 0);
+    (void)r;
+  }
+  return a->n;
+}
+
+typedef struct {
+  const corpus_t *c;
+  au_cache_t *cache;
+  au_buf_t out;
+} render_arg_t;
+
+static size_t do_render_json(void *arg)
+{
+  render_arg_t *a = arg;
+  const corpus_t *c = a->c;
+  for (size_t i = 0; i < c->naus; ++i) {
+    a->out.size = 0;
+    render_json(&ctx, a->cache, &a->out, NULL, NULL, c->pats[i].str, c->pats[i].len,
+        c->cmds[i].str, c->cmds[i].len, i + 1);
+  }
+  au_ctx_reset(&ctx);
+  return c->naus;
+}
+
+static size_t do_process(void *arg)
+{
+  const corpus_t *c = arg;
+  job_t job = { .path = (char *)c->path };
+  process(&ctx, NULL, &job);
+  au_buf_free(&job.out);
+  au_ctx_reset(&ctx);
+  return c->naus;
+}
+
+static void bench_corpus(const char *path)
+{
+  corpus_t c;
+  load_corpus(&c, path);
+  printf("%s: %zu bytes, %zu autocmds\n", path, c.size, c.naus);
+
+  slices_t pats = { c.pats, c.naus };
+  run("tokenize", do_tokenize, &pats, total_len(c.pats, c.naus));
+
+  // tokens are kept in a separate context, ctx is reset after every unroll
+  au_ctx_t tokctx;
+  au_ctx_init(&tokctx);
+  unroll_arg_t ua = { malloc(c.naus * sizeof(token_t *)), c.naus };
+  assert(ua.toks != NULL);
+  for (size_t i = 0; i < c.naus; ++i)
+    ua.toks[i] = tokenize_n(&tokctx, c.pats[i].str, c.pats[i].len);
+  run("unroll", do_unroll, &ua, total_len(c.pats, c.naus));
+  run("unroll (flat)", do_unroll_flat, &ua, total_len(c.pats, c.naus));
+  run("unroll (factorized)", do_unroll_dag, &ua, total_len(c.pats, c.naus));
+  free(ua.toks);
+  au_ctx_free(&tokctx);
+
+  slices_t words = { c.words, c.nwords };
+  run("match_autocmd", do_match_autocmd, &words, total_len(c.words, c.nwords));
+  slices_t events = { c.events, c.naus };
+  run("match_events", do_match_events, &events, total_len(c.events, c.naus));
+
+  size_t maxlen = 0;
+  for (size_t i = 0; i < c.naus; ++i)
+    maxlen = c.cmds[i].len > maxlen ? c.cmds[i].len : maxlen;
+  escape_arg_t ea = { c.cmds, c.naus, malloc(maxlen * 6 + 1), maxlen * 6 + 1 };
+  assert(ea.out != NULL);
+  run("write_escaped", do_write_escaped, &ea, total_len(c.cmds, c.naus));
+  free(ea.out);
+
+  opt_unroll = true;
+  render_arg_t ra = { &c, NULL, {0} };
+  run("render_json", do_render_json, &ra,
+      total_len(c.pats, c.naus) + total_len(c.cmds, c.naus));
+  // every pattern is a hit after the first run
+  au_cache_t cache;
+  au_cache_init(&cache);
+  ra.cache = &cache;
+  run("render_json (cached)", do_render_json, &ra,
+      total_len(c.pats, c.naus) + total_len(c.cmds, c.naus));
+  au_cache_free(&cache);
+  au_buf_free(&ra.out);
+  run("process (end-to-end)", do_process, &c, c.size);
+  opt_unroll = false;
+
+  free_corpus(&c);
+}
+
+static size_t do_tokenize_long(void *arg)
+{
+  tokenize(&ctx, arg);
+  au_ctx_reset(&ctx);
+  return 1;
+}
+
+static void bench_tokenize(void)
+{
+  slice_t s[LEN(patterns)];
+  for (size_t i = 0; i < LEN(patterns); ++i)
+    s[i] = (slice_t){ patterns[i], strlen(patterns[i]) };
+  slices_t pats = { s, LEN(patterns) };
+  run("tokenize (typical)", do_tokenize, &pats, total_len(s, LEN(patterns)));
+
+  // long pattern, mostly literals with a few branches in between
+  size_t size = 64 * 1024;
+  char *longpat = malloc(size + 1);
+  size_t n = 0;
+  const char *chunk = "*/some/long/directory/name/with/file_name_";
+  while (n + 80 < size) {
+    size_t len = strlen(chunk);
+    memcpy(longpat + n, chunk, len);
+    n += len;
+    n += sprintf(longpat + n, "%zu.{json,yaml,toml}\\,x,", n);
+  }
+  longpat[n] = '\0';
+  run("tokenize (long)", do_tokenize_long, longpat, n);
+  free(longpat);
+}
+
+typedef struct {
+  au_prog_t *progs[LEN(patterns)];
+  size_t lens[LEN(paths)];
+} match_arg_t;
+
+static size_t do_match(void *arg)
+{
+  const match_arg_t *a = arg;
+  volatile size_t matched = 0;
+  for (size_t i = 0; i < LEN(paths); ++i) {
+    for (size_t j = 0; j < LEN(patterns); ++j) {
+      if (au_match(a->progs[j], paths[i], a->lens[i])) {
+        ++matched;
+        break;
+      }
+    }
+  }
+  return LEN(paths);
+}
+
+static void bench_match(void)
+{
+  match_arg_t a;
+  for (size_t i = 0; i < LEN(patterns); ++i) {
+    token_t *toks = tokenize(&ctx, patterns[i]);
+    if (toks == NULL) {
+      fprintf(stderr, "tokenizing '%s' failed: %s\n", patterns[i], ctx.error);
+      exit(EXIT_FAILURE);
+    }
+    a.progs[i] = au_compile(&ctx, toks);
+    if (a.progs[i] == NULL) {
+      fprintf(stderr, "compiling '%s' failed: %s\n", patterns[i], ctx.error);
+      exit(EXIT_FAILURE);
+    }
+  }
+  au_ctx_reset(&ctx);
+  for (size_t i = 0; i < LEN(paths); ++i)
+    a.lens[i] = strlen(paths[i]);
+
+  run("au_match (first match)", do_match, &a, 0);
+
+  for (size_t i = 0; i < LEN(patterns); ++i)
+    au_free_prog(a.progs[i]);
+}
+
+typedef struct {
+  au_set_t *set;
+  size_t lens[LEN(paths)];
+} set_arg_t;
+
+static size_t do_set_match(void *arg)
+{
+  const set_arg_t *a = arg;
+  volatile size_t matched = 0;
+  for (size_t i = 0; i < LEN(paths); ++i)
+    matched += au_set_match(a->set, paths[i], a->lens[i]) != NULL;
+  return LEN(paths);
+}
+
+static size_t do_set_match_prefiltered(void *arg)
+{
+  const set_arg_t *a = arg;
+  volatile size_t matched = 0;
+  for (size_t i = 0; i < LEN(paths); ++i)
+    matched += au_set_match_prefiltered(a->set, paths[i], a->lens[i]) != NULL;
+  return LEN(paths);
+}
+
+static void bench_set(void)
+{
+  set_arg_t a = { au_set_new(), {0} };
+  for (size_t i = 0; i < LEN(patterns); ++i) {
+    token_t *toks = tokenize(&ctx, patterns[i]);
+    if (toks == NULL || !au_set_add(&ctx, a.set, toks, i + 1, NULL)) {
+      fprintf(stderr, "adding '%s' failed: %s\n", patterns[i], ctx.error);
+      exit(EXIT_FAILURE);
+    }
+  }
+  au_ctx_reset(&ctx);
+  for (size_t i = 0; i < LEN(paths); ++i)
+    a.lens[i] = strlen(paths[i]);
+
+  // first pass builds the automaton, it can only be measured once
+  double beg = now();
+  do_set_match(&a);
+  printf("%-28s %10.1f ns/item\n", "au_set_match (first pass)", (now() - beg) / LEN(paths));
+
+  run("au_set_match", do_set_match, &a, 0);
+  run("au_set_match_prefiltered", do_set_match_prefiltered, &a, 0);
+  au_set_free(a.set);
+}
+
+/// Generate a pattern with nested groups: every level is a literal,
+/// followed by a group with fanout alternatives of the next level.
+static void gen_nested(au_buf_t *out, size_t depth, size_t fanout, size_t litlen)
+{
+  for (size_t i = 0; i < litlen; ++i)
+    au_buf_putc(out, 'a' + (out->size % 26));
+  if (depth == 0)
+    return;
+  au_buf_putc(out, '{');
+  for (size_t i = 0; i < fanout; ++i) {
+    if (i > 0)
+      au_buf_putc(out, ',');
+    gen_nested(out, depth - 1, fanout, litlen);
+  }
+  au_buf_putc(out, '}');
+}
+
+typedef struct {
+  const char *pat;
+  size_t len;
+  size_t branches;
+  size_t peak;      /// largest arena size, in bytes
+  const char *error;
+} stress_arg_t;
+
+static size_t do_stress(void *arg)
+{
+  stress_arg_t *a = arg;
+  token_t *toks = tokenize_n(&ctx, a->pat, a->len);
+  const token_t ***res = toks != NULL ? unroll(&ctx, toks) : NULL;
+  a->error = res == NULL ? ctx.error : NULL;
+  a->branches = 0;
+  for (; res != NULL && res[a->branches] != NULL; ++a->branches)
+    ;
+  size_t size = ctx.arena.size + (ctx.refs_cap + ctx.offs_cap) * sizeof(uint32_t);
+  a->peak = size > a->peak ? size : a->peak;
+  au_ctx_reset(&ctx);
+  return a->branches > 0 ? a->branches : 1;
+}
+
+/// Unroll generated patterns with growing nesting depth, fan-out and
+/// literal length, to find where the cost stops growing with the output
+static void bench_stress(void)
+{
+  static const size_t depths[] = { 1, 2, 4, 6, 8, 10 };
+  static const size_t fanouts[] = { 2, 4, 16, 64, 128 };
+  static const size_t litlens[] = { 1, 16, 256 };
+  // keep the output, and the time it takes to produce it, within reason
+  const double max_branches = 1 << 14;
+
+  printf("%5s %6s %6s %10s %10s %12s %12s %8s %10s\n", "depth", "fanout", "litlen",
+      "bytes", "branches", "ms/pattern", "ns/branch", "±%", "peak KiB");
+  for (size_t d = 0; d < LEN(depths); ++d) {
+    for (size_t f = 0; f < LEN(fanouts); ++f) {
+      for (size_t l = 0; l < LEN(litlens); ++l) {
+        double branches = pow(fanouts[f], depths[d]);
+        if (branches > max_branches)
+          continue;
+
+        au_buf_t pat = {0};
+        gen_nested(&pat, depths[d], fanouts[f], litlens[l]);
+        if (pat.failed || pat.size > ((size_t)1 << 28)) {
+          au_buf_free(&pat);
+          continue;
+        }
+
+        // fresh arena, so that the peak is only from this pattern
+        au_ctx_free(&ctx);
+        au_ctx_init(&ctx);
+        ctx.unroll_threads = opt_threads;
+        stress_arg_t a = { pat.data, pat.size, 0, 0, NULL };
+        timing_t t = measure(do_stress, &a);
+        printf("%5zu %6zu %6zu %10zu ", depths[d], fanouts[f], litlens[l], pat.size);
+        if (a.error != NULL) {
+          printf("%10s  error: %s\n", "-", a.error);
+        } else {
+          printf("%10zu %12.3f %12.1f %8.1f %10zu\n", a.branches, t.mean / 1e6,
+              t.mean / a.branches, t.mean > 0 ? t.stddev / t.mean * 100 : 0, a.peak / 1024);
+        }
+        fflush(stdout);
+        au_buf_free(&pat);
+      }
+    }
+  }
+}
+
+static void usage(const char *name)
+{
+  fprintf(stderr, "Usage: %s [-w WARMUP] [-r REPEAT] [-s] [-j THREADS] [CORPUS]\n", name);
+  fprintf(stderr, "  CORPUS defaults to %s\n", DEFAULT_CORPUS);
+  fprintf(stderr, "  -s runs the unroll stress benchmark instead\n");
+  fprintf(stderr, "  -j unrolls big patterns on THREADS threads in the stress benchmark\n");
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *corpus = DEFAULT_CORPUS;
+  bool stress = false;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+      opt_warmup = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      opt_repeat = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-s") == 0) {
+      stress = true;
+    } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      opt_threads = strtoul(argv[++i], NULL, 10);
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+    } else {
+      corpus = argv[i];
+    }
+  }
+  if (opt_repeat == 0)
+    opt_repeat = 1;
+
+  printf("%zu warmup runs, %zu timed runs\n", opt_warmup, opt_repeat);
+  if (stress) {
+    bench_stress();
+    au_ctx_free(&ctx);
+    return EXIT_SUCCESS;
+  }
+  bench_corpus(corpus);
+  bench_tokenize();
+  bench_match();
+  bench_set();
+  au_ctx_free(&ctx);
+  return EXIT_SUCCESS;
+}
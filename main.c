@@ -6,88 +6,310 @@
 #include <stdnoreturn.h>
 #include <ctype.h>
 #include <assert.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/inotify.h>
+#include <poll.h>
+#include <time.h>
 
-#define BUF_SIZE (1024)
+#define IOV_BATCH (64)
+#define WATCH_DELAY (10) /// ms to wait for more changes before rewriting output
 
 static const char *progname = NULL;
 static bool opt_unroll = false;
+static bool opt_dag = false;    /// factorized unroll result
 static bool opt_tree = true;
 static bool opt_json = true;
 static bool opt_raw_patterns = false;
-static const char *opt_input = NULL;
+static bool opt_minify = false;
+static bool opt_binary = false;
+static bool opt_cache = false;  /// reuse results of repeated patterns
+static const char *opt_cache_dir = NULL; /// keep results between runs here
+static bool opt_stats = false;  /// print cache statistics
+static bool opt_file = false; /// add file name to the output
+static long opt_jobs = 0;     /// number of worker threads, 0 for number of CPUs
+static long opt_unroll_max = 0; /// max number of unrolled branches, 0 for no limit
+static const char *opt_output = NULL; /// output file, stdout if NULL
+static bool opt_incremental = false;  /// reuse output of unchanged blocks from opt_output
+static bool opt_watch = false;  /// rewrite opt_output when input files change
+
+/// Rendered autocmd block, saved next to the output for incremental runs
+typedef struct {
+  uint64_t hash;    /// fingerprint of the pattern and command
+  uint64_t off;     /// offset in output
+  uint32_t pre;     /// length of the part before file and line number
+  uint32_t post;    /// offset of the part after them
+  uint32_t len;     /// length of the whole block
+  uint32_t reserved;
+} block_t;
+
+/// Header of the block list file
+typedef struct {
+  char magic[4];    /// BLOCKS_MAGIC
+  uint32_t version; /// BLOCKS_VERSION
+  uint64_t options; /// fingerprint of the options that change rendered blocks
+  uint64_t outsize; /// size of the output file it belongs to
+  uint64_t nblocks;
+} blocks_header_t;
+
+#define BLOCKS_MAGIC "AUPI"
+#define BLOCKS_VERSION (1)
+#define BLOCKS_SUFFIX ".blocks"
+
+/// Input file, processed by one of the workers
+typedef struct {
+  char *path;       /// file name, "-" for stdin
+  au_buf_t out;     /// rendered output
+  au_bin_writer_t bin; /// binary output
+  au_buf_t blocks;  /// block_t of every rendered autocmd, with opt_incremental
+  size_t reused;    /// number of blocks taken from the previous output
+  size_t count;     /// number of rendered patterns
+  bool ok;          /// processed without errors
+  bool done;        /// finished, output can be written
+  bool changed;     /// file changed, has to be processed again in watch mode
+  int wd;           /// inotify watch of the parent directory, in watch mode
+} job_t;
+
+static job_t *jobs = NULL;
+static size_t njobs = 0;
+static size_t jobcap = 0;
+static size_t next_job = 0; /// next job to pick up by a worker
+static pthread_mutex_t jobs_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobs_done = PTHREAD_COND_INITIALIZER;
+static size_t cache_hits = 0;   /// summed up from all workers, under jobs_lock
+static size_t cache_misses = 0;
+static size_t cache_loaded = 0;
+static au_store_t store;        /// results from the previous run, with opt_cache_dir
+static bool store_open = false;
+static size_t unroll_threads = 1; /// threads every worker unrolls big patterns with
+static size_t blocks_reused = 0; /// of the last output, with opt_incremental
+static size_t blocks_total = 0;
+
+// output of the previous run, with opt_incremental
+static char *prev_data = NULL;
+static size_t prev_size = 0;
+static bool prev_mapped = false;
+static const block_t *prev_blocks = NULL;
+static uint32_t *prev_index = NULL; /// block index + 1 by hash, 0 if empty
+static size_t prev_cap = 0;
+static char *prev_blocks_data = NULL;
+static size_t prev_blocks_size = 0;
+static bool prev_blocks_mapped = false;
+
+#define STORE_NAME "patterns.cache"
 
 // TODO: clean all of this up
 
-static bool parse(const char *pat)
+static bool parse(au_ctx_t *ctx, au_buf_t *out, const char *pat, size_t patlen)
 {
-  fprintf(stdout, "%s\n", pat);
+  au_buf_put(out, pat, patlen);
+  au_buf_putc(out, '\n');
 
-  token_t *tokens = tokenize(pat);
+  // everything from the previous pattern can go
+  au_ctx_reset(ctx);
+  token_t *tokens = tokenize_n(ctx, pat, patlen);
   if (tokens == NULL) {
-    fprintf(stderr, "tokenizing failed: %s\n", error);
+    fprintf(stderr, "tokenizing failed: %s\n", ctx->error);
     return false;
   }
 
-  const token_t ***res = unroll(tokens);
-  if (res == NULL) {
-    fprintf(stderr, "unrolling failed: %s\n", error);
-    free(tokens);
-    return false;
+  au_unroll_t it;
+  const token_t **branch;
+  if (!au_unroll_init(ctx, &it, tokens))
+    goto fail;
+  while (au_unroll_next(&it, &branch)) {
+    if (branch == NULL)
+      return true;
+    au_buf_pad(out, 4);
+    for (const token_t **p = branch; *p != NULL; ++p)
+      au_buf_put(out, (*p)->beg, (*p)->len);
+    au_buf_putc(out, '\n');
   }
 
-  for (const token_t ***it = res; *it != NULL; ++it) {
-    fprintf(stdout, "    ");
-    print_tokens(*it);
+fail:
+  fprintf(stderr, "unrolling failed: %s\n", ctx->error);
+  return false;
+}
+
+/// Start new line with indentation, unless minified
+static inline void newline(au_buf_t *out, size_t indent)
+{
+  if (opt_minify)
+    return;
+  au_buf_putc(out, '\n');
+  au_buf_pad(out, indent);
+}
+
+/// Write autocmd command. Continuation lines are joined together,
+/// without the leading backslash and whitespace.
+/// @param[in]  cmd     command, up to the end of its last continuation line
+/// @param[in]  len     command length
+/// @param[in]  escape  escape for JSON
+static void write_cmd(au_buf_t *out, const char *cmd, size_t len, bool escape)
+{
+  const char *end = cmd + len;
+  for (const char *it = cmd; it < end;) {
+    const char *seg = it;
+    while (it < end && *it != '\r' && *it != '\n')
+      ++it;
+    if (escape)
+      au_buf_escape(out, seg, it - seg);
+    else
+      au_buf_put(out, seg, it - seg);
+    if (it == end)
+      break;
+
+    // skip the rest of the line and the backslash on the next one
+    while (it < end && *it != '\n')
+      ++it;
+    while (it < end && isspace((unsigned char)*it))
+      ++it;
+    if (it < end && *it == '\\')
+      ++it;
+    while (it < end && isspace((unsigned char)*it) && *it != '\n')
+      ++it;
   }
+}
 
-  free_tokens(res);
-  free(tokens);
-  return true;
+/// Write token as a JSON object
+static inline void write_token(au_buf_t *out, const token_t *tok)
+{
+  au_buf_puts(out, "{\"type\":\"");
+  au_buf_puts(out, type_str(tok->type));
+  au_buf_puts(out, "\",\"value\":\"");
+  au_buf_escape(out, tok->beg, tok->len);
+  au_buf_puts(out, "\"}");
 }
 
-static bool render_json(const char *pat, const char *cmd, size_t lnum)
+/// Write branch of the unroll result as a JSON object
+static void write_branch(au_buf_t *out, const token_t **branch, size_t count)
 {
-  char buf[BUF_SIZE];
-  int r;
+  if (count > 0)
+    au_buf_putc(out, ',');
+  newline(out, 6);
+  au_buf_puts(out, "{\"pattern\":\"");
+  for (const token_t **p = branch; *p != NULL; ++p)
+    au_buf_escape(out, (*p)->beg, (*p)->len);
+  au_buf_puts(out, "\",\"tokens\":[");
+  for (const token_t **p = branch; *p != NULL; ++p) {
+    if ((*p)->type == Empty)
+      continue;
+    newline(out, 8);
+    write_token(out, *p);
+    if (*(p + 1) != NULL)
+      au_buf_putc(out, ',');
+  }
+  newline(out, 6);
+  au_buf_puts(out, "]}");
+}
 
-  r = write_escaped(buf, BUF_SIZE, pat, strlen(pat));
-  assert(r >= 0);
-  printf("  {\n    \"pattern\":\"%s\"", buf);
+/// Write error as the last field of the JSON object
+static void write_error(au_buf_t *out, const char *error)
+{
+  au_buf_putc(out, ',');
+  newline(out, 4);
+  au_buf_puts(out, "\"error\":\"");
+  au_buf_escape(out, error, strlen(error));
+  au_buf_puts(out, "\"}");
+}
 
-  if (lnum != 0)
-    printf(",\n    \"lnum\":%ld", lnum);
-  if (cmd != NULL)
-    printf(",\n    \"cmd\":\"%s\"", cmd);
+/// Write factorized unroll result. Groups are lists of sequence indexes,
+/// sequences are lists of tokens and group references.
+static void write_dag(au_buf_t *out, const au_dag_t *dag)
+{
+  au_buf_putc(out, ',');
+  newline(out, 4);
+  au_buf_puts(out, "\"dag\":{");
+  newline(out, 6);
+  au_buf_puts(out, "\"groups\":[");
+  for (size_t i = 0; i < dag->ngroups; ++i) {
+    if (i > 0)
+      au_buf_putc(out, ',');
+    au_buf_putc(out, '[');
+    for (uint32_t k = 0; k < dag->groups[i].nseqs; ++k) {
+      if (k > 0)
+        au_buf_putc(out, ',');
+      au_buf_putu(out, dag->groups[i].seqs + k);
+    }
+    au_buf_putc(out, ']');
+  }
+  au_buf_puts(out, "],");
+  newline(out, 6);
+  au_buf_puts(out, "\"seqs\":[");
+  for (size_t i = 0; i < dag->nseqs; ++i) {
+    if (i > 0)
+      au_buf_putc(out, ',');
+    newline(out, 8);
+    au_buf_putc(out, '[');
+    const au_dag_seq_t *seq = &dag->seqs[i];
+    for (uint32_t k = 0; k < seq->nitems; ++k) {
+      if (k > 0)
+        au_buf_putc(out, ',');
+      uint32_t item = dag->items[seq->items + k];
+      if (item & AU_DAG_GROUP) {
+        au_buf_puts(out, "{\"group\":");
+        au_buf_putu(out, item & ~AU_DAG_GROUP);
+        au_buf_putc(out, '}');
+      } else {
+        write_token(out, &dag->toks[item]);
+      }
+    }
+    au_buf_putc(out, ']');
+  }
+  if (dag->nseqs > 0)
+    newline(out, 6);
+  au_buf_putc(out, ']');
+  newline(out, 4);
+  au_buf_putc(out, '}');
+}
 
-  token_t *tokens = tokenize(pat);
-  if (tokens == NULL) {
-    r = write_escaped(buf, BUF_SIZE, error, strlen(error));
-    assert(r >= 0);
-    printf(",\n    \"error\":\"%s\"}", buf);
-    return false;
+/// Write tree and unroll result, and close the JSON object
+/// @param[in]  entry   cached tokens and unroll result, tokenize and unroll if NULL
+static bool render_parsed(au_ctx_t *ctx, const au_cache_entry_t *entry,
+    au_buf_t *out, const char *pat, size_t patlen)
+{
+  const token_t *tokens;
+  au_jump_t *jumps = NULL;
+  if (entry != NULL) {
+    tokens = entry->toks;
+    if (tokens == NULL) {
+      ctx->error = entry->error;
+      goto fail;
+    }
+  } else {
+    // groups are linked once for unrolling
+    tokens = opt_unroll ? tokenize_jumps(ctx, pat, patlen, &jumps) : tokenize_n(ctx, pat, patlen);
+    if (tokens == NULL)
+      goto fail;
   }
 
   if (opt_tree) {
-    printf(",\n    \"tree\":[[");
+    au_buf_putc(out, ',');
+    newline(out, 4);
+    au_buf_puts(out, "\"tree\":[[");
     for (const token_t *tok = tokens; tok->type; ++tok) {
       const token_t *ntok = tok + 1;
       bool comma = ntok->type != End && ntok->type != Branch && ntok->type != Pop;
 
       if (tok->type == Push) {
-        printf("\n    ");
-        for (int i = 0; i < tok->lvl; ++i)
-          printf("  ");
-        printf("{\"type\":\"Branch\",\"value\":[[");
+        newline(out, 4 + 2 * tok->lvl);
+        au_buf_puts(out, "{\"type\":\"Branch\",\"value\":[[");
         continue;
       } else if (tok->type == Branch) {
-        printf("],[");
+        au_buf_puts(out, "],[");
         continue;
       } else if (tok->type == Pop) {
-        printf("]]}");
+        au_buf_puts(out, "]]}");
         if (comma) {
-          printf(",");
+          au_buf_putc(out, ',');
         } else if (!ntok->type) {
-          printf("\n    ");
+          newline(out, 4);
         }
         continue;
       }
@@ -95,103 +317,274 @@ static bool render_json(const char *pat, const char *cmd, size_t lnum)
       if (tok->type == Empty)
         continue;
 
-      r = write_escaped(buf, BUF_SIZE, tok->beg, tok->len);
-      assert(r >= 0);
-      printf("\n      ");
-      for (int i = 0; i < tok->lvl; ++i)
-        printf("  ");
-      printf("{\"type\":\"%s\",\"value\":\"%s\"}", type_str(tok->type), buf);
+      newline(out, 6 + 2 * tok->lvl);
+      write_token(out, tok);
       if (comma) {
-        printf(",");
+        au_buf_putc(out, ',');
       } else if (!ntok->type) {
-        printf("\n    ");
+        newline(out, 4);
       } else {
-        printf("\n    ");
-        for (int i = 0; i < tok->lvl; ++i)
-          printf("  ");
+        newline(out, 4 + 2 * tok->lvl);
       }
     }
-    printf("]]");
+    au_buf_puts(out, "]]");
+  }
+
+  if (opt_dag) {
+    au_dag_t dag;
+    if (!au_unroll_dag(ctx, tokens, &dag))
+      goto fail;
+    write_dag(out, &dag);
   }
 
   if (opt_unroll) {
-    const token_t ***res = unroll(tokens);
-    if (res == NULL) {
-      r = write_escaped(buf, BUF_SIZE, error, strlen(error));
-      assert(r >= 0);
-      printf(",\n    \"error\":\"%s\"}", buf);
-      free(tokens);
-      return false;
+    // branches are written out as they're produced, except for cached and
+    // big patterns, big ones are unrolled at once so it can be done in
+    // parallel. on error the ones before it stay in the result and the
+    // error follows
+    au_unroll_t it;
+    const token_t **branch;
+    bool whole = entry != NULL;
+    const token_t ***res = NULL;
+    size_t nres = 0;
+    const char *error = NULL;
+    size_t total;
+    if (entry != NULL) {
+      res = entry->res;
+      nres = entry->nres;
+      error = entry->error;
+    } else if (ctx->unroll_threads > 1 && au_unroll_count(ctx, tokens, &total)
+        && total >= AU_UNROLL_PARALLEL_MIN) {
+      whole = true;
+      au_branches_t br;
+      if (!au_unroll_flat(ctx, tokens, &br))
+        error = ctx->error;
+      if (br.offs != NULL && (res = au_branches_expand(&ctx->arena, &br, tokens)) == NULL)
+        error = "malloc";
+      nres = res != NULL ? br.nbranches : 0;
+    } else if (!au_unroll_init_jumps(ctx, &it, tokens, jumps)) {
+      goto fail;
+    }
+    if (whole && res == NULL) {
+      ctx->error = error;
+      goto fail;
     }
 
-    printf(",\n    \"result\":[");
-    for (const token_t ***it = res; *it != NULL; ++it) {
-      size_t n = 0;
-      for (const token_t **p = *it; *p != NULL; ++p) {
-        const token_t *tok = *p;
-        r = write_escaped(buf + n, BUF_SIZE - n, tok->beg, tok->len);
-        assert(r >= 0);
-        n += r;
-        assert(n < BUF_SIZE - 1);
-      }
-      printf("\n      {\"pattern\":\"%s\",\"tokens\":[", buf);
-      for (const token_t **p = *it; *p != NULL; ++p) {
-        const token_t *tok = *p;
-        if (tok->type == Empty)
-          continue;
-        r = write_escaped(buf, BUF_SIZE, tok->beg, tok->len);
-        assert(r >= 0);
-        printf("\n        {\"type\":\"%s\",\"value\":\"%s\"}%s",
-            type_str(tok->type), buf, *(p + 1) == NULL ? "" : ",");
-      }
-      printf("\n      ]}%s", *(it + 1) == NULL ? "\n    " : ",");
+    bool ok = true;
+    size_t count = 0;
+    au_buf_putc(out, ',');
+    newline(out, 4);
+    au_buf_puts(out, "\"result\":[");
+    if (whole) {
+      for (; count < nres; ++count)
+        write_branch(out, res[count], count);
+      ok = error == NULL;
+      ctx->error = error;
+    } else {
+      while ((ok = au_unroll_next(&it, &branch)) && branch != NULL)
+        write_branch(out, branch, count++);
     }
-    printf("]");
-    free_tokens(res);
+    if (count > 0)
+      newline(out, 4);
+    au_buf_putc(out, ']');
+    if (!ok)
+      goto fail;
   }
-  printf("\n  }");
-
-  free(tokens);
+  newline(out, 2);
+  au_buf_putc(out, '}');
   return true;
+
+fail:
+  write_error(out, ctx->error);
+  return false;
 }
 
-static void escape_cmd(char **str, size_t *cap)
+/// Write source file and line number fields
+static void write_location(au_buf_t *out, const char *file, size_t lnum)
 {
-  size_t ncap = strlen(*str) * 2 + 1;
-  char *buf = malloc(ncap);
-  assert(buf != NULL);
-  size_t n = 0;
-  for (char *c = *str; *c != '\0'; ++c) {
-    if (*c == '\\' || *c == '"')
-      buf[n++] = '\\';
-    buf[n++] = *c;
+  if (file != NULL) {
+    au_buf_putc(out, ',');
+    newline(out, 4);
+    au_buf_puts(out, "\"file\":\"");
+    au_buf_escape(out, file, strlen(file));
+    au_buf_putc(out, '"');
+  }
+
+  if (lnum != 0) {
+    au_buf_putc(out, ',');
+    newline(out, 4);
+    au_buf_puts(out, "\"lnum\":");
+    au_buf_putu(out, lnum);
   }
-  buf[n] = '\0';
-  free(*str);
-  *str = buf;
-  *cap = ncap;
+}
+
+/// @param[in]  cache   repeated patterns are taken from it, can be NULL
+/// @param[out] blk     where the location fields are, relative to blk->off. can be NULL
+static bool render_json(au_ctx_t *ctx, au_cache_t *cache, au_buf_t *out, block_t *blk,
+    const char *file, const char *pat, size_t patlen, const char *cmd, size_t cmdlen, size_t lnum)
+{
+  if (!opt_minify)
+    au_buf_pad(out, 2);
+  au_buf_putc(out, '{');
+  newline(out, 4);
+  au_buf_puts(out, "\"pattern\":\"");
+  au_buf_escape(out, pat, patlen);
+  au_buf_putc(out, '"');
+
+  if (blk != NULL)
+    blk->pre = out->size - blk->off;
+  write_location(out, file, lnum);
+  if (blk != NULL)
+    blk->post = out->size - blk->off;
+
+  if (cmd != NULL) {
+    au_buf_putc(out, ',');
+    newline(out, 4);
+    au_buf_puts(out, "\"cmd\":\"");
+    write_cmd(out, cmd, cmdlen, true);
+    au_buf_putc(out, '"');
+  }
+
+  au_ctx_reset(ctx);
+  if (cache == NULL)
+    return render_parsed(ctx, NULL, out, pat, patlen);
+
+  // everything after the command is the same for repeated patterns
+  const au_cache_entry_t *entry = au_cache_get(ctx, cache, pat, patlen, opt_unroll);
+  if (entry == NULL) {
+    write_error(out, ctx->error);
+    return false;
+  }
+  if (entry->data != NULL) {
+    au_buf_put(out, entry->data, entry->size);
+    return entry->error == NULL;
+  }
+  size_t start = out->size;
+  bool ok = render_parsed(ctx, entry, out, pat, patlen);
+  if (!out->failed)
+    au_cache_set_data(cache, entry, out->data + start, out->size - start);
+  return ok;
 }
 
 static void print_help(void)
 {
-  fprintf(stderr, "Usage: %s [option]... <file>\n", progname);
-  fprintf(stderr, "    -u  unroll branches\n");
-  fprintf(stderr, "    -t  disable tree\n");
-  fprintf(stderr, "    -p  parse raw patterns (parses vim script file by default)\n");
-  fprintf(stderr, "    -d  for debugging\n");
+  fprintf(stderr, "Usage: %s [option]... <file|directory>...\n", progname);
+  fprintf(stderr, "    -u    unroll branches\n");
+  fprintf(stderr, "    -f    factorized unroll, groups are shared instead of expanded\n");
+  fprintf(stderr, "    -t    disable tree\n");
+  fprintf(stderr, "    -m    minify json output\n");
+  fprintf(stderr, "    -b    binary output, see auparser.h\n");
+  fprintf(stderr, "    -c    reuse results of repeated patterns\n");
+  fprintf(stderr, "    -C D  keep results between runs in directory D, implies -c\n");
+  fprintf(stderr, "    -o F  write output to file F\n");
+  fprintf(stderr, "    -i    render only changed autocmds, reusing the previous output of -o\n");
+  fprintf(stderr, "    -w    watch input files and rewrite output of -o when they change\n");
+  fprintf(stderr, "    -s    print cache statistics\n");
+  fprintf(stderr, "    -p    parse raw patterns (parses vim script file by default)\n");
+  fprintf(stderr, "    -d    for debugging\n");
+  fprintf(stderr, "    -j N  number of worker threads (default: number of CPUs)\n");
+  fprintf(stderr, "    -U N  refuse to unroll patterns with more than N branches\n");
+}
+
+static void add_job(const char *path)
+{
+  if (njobs >= jobcap) {
+    jobcap = jobcap ? jobcap * 2 : 16;
+    jobs = realloc(jobs, jobcap * sizeof(job_t));
+    assert(jobs != NULL);
+  }
+  jobs[njobs] = (job_t){ .path = strdup(path) };
+  assert(jobs[njobs].path != NULL);
+  ++njobs;
+}
+
+static int compare_names(const void *a, const void *b)
+{
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/// Add all *.vim files in a directory, recursively, sorted by name
+static void add_directory(const char *path)
+{
+  DIR *dir = opendir(path);
+  if (dir == NULL) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return;
+  }
+
+  char **names = NULL;
+  size_t nnames = 0;
+  size_t namecap = 0;
+  struct dirent *ent;
+  while ((ent = readdir(dir)) != NULL) {
+    if (ent->d_name[0] == '.')
+      continue;
+    if (nnames >= namecap) {
+      namecap = namecap ? namecap * 2 : 16;
+      names = realloc(names, namecap * sizeof(char *));
+      assert(names != NULL);
+    }
+    names[nnames] = strdup(ent->d_name);
+    assert(names[nnames] != NULL);
+    ++nnames;
+  }
+  closedir(dir);
+  qsort(names, nnames, sizeof(char *), compare_names);
+
+  size_t plen = strlen(path);
+  while (plen > 1 && path[plen - 1] == '/')
+    --plen;
+  for (size_t i = 0; i < nnames; ++i) {
+    size_t nlen = strlen(names[i]);
+    char *full = malloc(plen + nlen + 2);
+    assert(full != NULL);
+    memcpy(full, path, plen);
+    full[plen] = '/';
+    memcpy(full + plen + 1, names[i], nlen + 1);
+
+    struct stat st;
+    if (stat(full, &st) == 0) {
+      if (S_ISDIR(st.st_mode))
+        add_directory(full);
+      else if (S_ISREG(st.st_mode) && nlen > 4 && strcmp(names[i] + nlen - 4, ".vim") == 0)
+        add_job(full);
+    }
+    free(full);
+    free(names[i]);
+  }
+  free(names);
+}
+
+static void add_input(const char *path)
+{
+  struct stat st;
+  if (strcmp(path, "-") != 0 && stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+    add_directory(path);
+  else
+    add_job(path);
+}
+
+/// Parse positive number option argument, exits on error
+static long parse_number(const char *arg, const char *what)
+{
+  char *end;
+  long res;
+  if (arg == NULL || (res = strtol(arg, &end, 10)) <= 0 || *end != '\0') {
+    fprintf(stderr, "Invalid %s\n", what);
+    print_help();
+    exit(EXIT_FAILURE);
+  }
+  return res;
 }
 
 static void parse_options(int argc, char **argv)
 {
   for (int i = 1; i < argc; ++i) {
-    if (argv[i][0] == '-') {
+    if (strcmp(argv[i], "--watch") == 0) {
+      opt_watch = true;
+    } else if (argv[i][0] == '-') {
       if (argv[i][1] == '\0') {
-        if (opt_input != NULL) {
-          fprintf(stderr, "Multiple input files not allowed\n");
-          print_help();
-          exit(EXIT_FAILURE);
-        }
-        opt_input = "-";
+        add_input("-");
       } else {
         for (char *c = argv[i] + 1; *c != '\0'; ++c) {
           if (*c == 'p') {
@@ -200,8 +593,44 @@ static void parse_options(int argc, char **argv)
             opt_json = false;
           } else if (*c == 'u') {
             opt_unroll = true;
+          } else if (*c == 'f') {
+            opt_dag = true;
           } else if (*c == 't') {
             opt_tree = false;
+          } else if (*c == 'm') {
+            opt_minify = true;
+          } else if (*c == 'c') {
+            opt_cache = true;
+          } else if (*c == 'o') {
+            opt_output = c[1] != '\0' ? c + 1 : argv[++i];
+            if (opt_output == NULL) {
+              fprintf(stderr, "Missing output file\n");
+              exit(EXIT_FAILURE);
+            }
+            break;
+          } else if (*c == 'i') {
+            opt_incremental = true;
+          } else if (*c == 'w') {
+            opt_watch = true;
+          } else if (*c == 'C') {
+            opt_cache_dir = c[1] != '\0' ? c + 1 : argv[++i];
+            opt_cache = true;
+            if (opt_cache_dir == NULL) {
+              fprintf(stderr, "Missing cache directory\n");
+              exit(EXIT_FAILURE);
+            }
+            break;
+          } else if (*c == 's') {
+            opt_stats = true;
+          } else if (*c == 'b') {
+            opt_binary = true;
+            opt_json = false;
+          } else if (*c == 'j') {
+            opt_jobs = parse_number(c[1] != '\0' ? c + 1 : argv[++i], "number of jobs");
+            break;
+          } else if (*c == 'U') {
+            opt_unroll_max = parse_number(c[1] != '\0' ? c + 1 : argv[++i], "unroll limit");
+            break;
           } else if (*c == 'h') {
             print_help();
             exit(EXIT_SUCCESS);
@@ -213,207 +642,840 @@ static void parse_options(int argc, char **argv)
         }
       }
     } else {
-      if (opt_input != NULL) {
-        fprintf(stderr, "Multiple input files not allowed\n");
-        print_help();
-      }
-      opt_input = argv[i];
+      add_input(argv[i]);
     }
   }
 
-  if (opt_input == NULL) {
+  if (njobs == 0) {
     fprintf(stderr, "No input file\n");
     print_help();
     exit(EXIT_FAILURE);
   }
+
+  size_t nstdin = 0;
+  for (size_t i = 0; i < njobs; ++i)
+    nstdin += strcmp(jobs[i].path, "-") == 0;
+  if (nstdin > 1) {
+    fprintf(stderr, "Standard input can be read only once\n");
+    print_help();
+    exit(EXIT_FAILURE);
+  }
+
+  if (opt_incremental && (opt_output == NULL || !opt_json)) {
+    fprintf(stderr, "-i needs json output written to a file with -o\n");
+    exit(EXIT_FAILURE);
+  }
+  if (opt_watch && opt_output == NULL) {
+    fprintf(stderr, "-w needs output written to a file with -o\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // with multiple inputs every entry records where it came from
+  opt_file = njobs > 1;
 }
 
-int main(int argc, char *argv[])
+/// Add autocmd to the binary output of the job
+static bool render_binary(au_ctx_t *ctx, job_t *job, const char *file,
+    const char *pat, size_t patlen, const char *cmd, size_t cmdlen, size_t lnum)
 {
-  assert(argc > 0);
-  progname = argv[0];
-  parse_options(argc, argv);
+  // continuation lines are joined in the output buffer, it's not used otherwise
+  job->out.size = 0;
+  if (cmd != NULL)
+    write_cmd(&job->out, cmd, cmdlen, false);
 
-  FILE *fp = NULL;
-  if (opt_input[0] == '-' && opt_input[1] == '\0') {
-    fp = stdin;
-  } else {
-    fp = fopen(opt_input, "rb");
-    if (fp == NULL) {
-      perror("fopen");
-      return EXIT_FAILURE;
+  au_bin_source_t src = {
+    .pat = pat,
+    .patlen = patlen,
+    .cmd = cmd != NULL ? (job->out.data != NULL ? job->out.data : "") : NULL,
+    .cmdlen = job->out.size,
+    .file = file,
+    .lnum = lnum,
+  };
+  au_ctx_reset(ctx);
+  return au_bin_add(ctx, &job->bin, &src, (opt_unroll ? AU_BIN_UNROLLED : 0) | (opt_dag ? AU_BIN_FACTORIZED : 0));
+}
+
+/// Map input file into memory, or read it if it can't be mapped
+/// @param[out] data    file contents
+/// @param[out] size    file size
+/// @param[out] mapped  true if data has to be unmapped instead of freed
+/// @return     false on error
+static bool load_input(const char *path, char **data, size_t *size, bool *mapped)
+{
+  int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  *data = NULL;
+  *size = 0;
+  *mapped = false;
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+    if (st.st_size == 0)
+      goto done;
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED) {
+      madvise(p, st.st_size, MADV_SEQUENTIAL);
+      *data = p;
+      *size = st.st_size;
+      *mapped = true;
+      goto done;
+    }
+  }
+
+  // pipes and such, read everything into a single buffer
+  size_t cap = 0;
+  for (;;) {
+    if (*size == cap) {
+      cap = cap ? cap * 2 : 64 * 1024;
+      char *ndata = realloc(*data, cap);
+      assert(ndata != NULL);
+      *data = ndata;
+    }
+    ssize_t r = read(fd, *data + *size, cap - *size);
+    if (r < 0) {
+      if (errno == EINTR)
+        continue;
+      free(*data);
+      if (fd != STDIN_FILENO)
+        close(fd);
+      return false;
     }
+    if (r == 0)
+      break;
+    *size += r;
+  }
+
+done:
+  if (fd != STDIN_FILENO)
+    close(fd);
+  return true;
+}
+
+static inline const char *skip_space(const char *it, const char *end)
+{
+  while (it < end && isspace((unsigned char)*it))
+    ++it;
+  return it;
+}
+
+static inline const char *skip_to_space(const char *it, const char *end)
+{
+  while (it < end && !isspace((unsigned char)*it))
+    ++it;
+  return it;
+}
+
+static inline const char *skip_to_newline(const char *it, const char *end)
+{
+  while (it < end && *it != '\r' && *it != '\n')
+    ++it;
+  return it;
+}
+
+/// FNV-1a of the pattern and command, same options give the same output for them
+static uint64_t fingerprint(const char *pat, size_t patlen, const char *cmd, size_t cmdlen)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < patlen; ++i)
+    h = (h ^ (unsigned char)pat[i]) * 0x100000001b3ULL;
+  // separate pattern from command, and no command from an empty one
+  h = (h ^ (cmd != NULL ? 0x100 : 0x200)) * 0x100000001b3ULL;
+  for (size_t i = 0; cmd != NULL && i < cmdlen; ++i)
+    h = (h ^ (unsigned char)cmd[i]) * 0x100000001b3ULL;
+  return h;
+}
+
+/// Fingerprint of the options that change rendered blocks
+static uint64_t options_fingerprint(void)
+{
+  uint64_t opts[] = {
+    AU_PARSER_VERSION, opt_unroll, opt_dag, opt_tree, opt_minify, opt_raw_patterns, opt_unroll_max,
+  };
+  return fingerprint((const char *)opts, sizeof(opts), NULL, 0);
+}
+
+static const block_t *find_block(uint64_t hash)
+{
+  if (prev_cap == 0)
+    return NULL;
+  for (size_t i = hash & (prev_cap - 1); prev_index[i] != 0; i = (i + 1) & (prev_cap - 1)) {
+    if (prev_blocks[prev_index[i] - 1].hash == hash)
+      return &prev_blocks[prev_index[i] - 1];
+  }
+  return NULL;
+}
+
+/// Render autocmd as JSON. In incremental mode the output of the previous
+/// run is reused when the pattern and command didn't change, only the
+/// location is written again.
+static void render_block(au_ctx_t *ctx, au_cache_t *cache, job_t *job, const char *file,
+    const char *pat, size_t patlen, const char *cmd, size_t cmdlen, size_t lnum)
+{
+  au_buf_t *out = &job->out;
+  if (!opt_incremental) {
+    render_json(ctx, cache, out, NULL, file, pat, patlen, cmd, cmdlen, lnum);
+    return;
+  }
+
+  block_t blk = { .hash = fingerprint(pat, patlen, cmd, cmdlen), .off = out->size };
+  const block_t *prev = find_block(blk.hash);
+  if (prev != NULL) {
+    const char *data = prev_data + prev->off;
+    au_buf_put(out, data, prev->pre);
+    blk.pre = prev->pre;
+    write_location(out, file, lnum);
+    blk.post = out->size - blk.off;
+    au_buf_put(out, data + prev->post, prev->len - prev->post);
+    ++job->reused;
+  } else {
+    render_json(ctx, cache, out, &blk, file, pat, patlen, cmd, cmdlen, lnum);
+  }
+  blk.len = out->size - blk.off;
+  au_buf_put(&job->blocks, (const char *)&blk, sizeof(blk));
+}
+
+/// Load output and blocks of the previous run. Everything is rendered
+/// again if they don't match each other or the current options.
+static void load_previous(const char *path)
+{
+  size_t len = strlen(path) + sizeof(BLOCKS_SUFFIX);
+  char *bpath = malloc(len);
+  assert(bpath != NULL);
+  snprintf(bpath, len, "%s%s", path, BLOCKS_SUFFIX);
+
+  bool ok = load_input(path, &prev_data, &prev_size, &prev_mapped)
+    && load_input(bpath, &prev_blocks_data, &prev_blocks_size, &prev_blocks_mapped);
+  free(bpath);
+  if (!ok)
+    return;
+
+  size_t bsize = prev_blocks_size;
+  const blocks_header_t *h = (const blocks_header_t *)prev_blocks_data;
+  if (bsize < sizeof(blocks_header_t) || memcmp(h->magic, BLOCKS_MAGIC, 4) != 0
+      || h->version != BLOCKS_VERSION || h->options != options_fingerprint()
+      || h->outsize != prev_size || h->nblocks != (bsize - sizeof(*h)) / sizeof(block_t)
+      || (bsize - sizeof(*h)) % sizeof(block_t) != 0)
+    return;
+  const block_t *blocks = (const block_t *)(h + 1);
+  for (uint64_t i = 0; i < h->nblocks; ++i) {
+    const block_t *b = &blocks[i];
+    if (b->off > prev_size || b->len > prev_size - b->off || b->pre > b->post || b->post > b->len)
+      return;
   }
 
-  char *line = NULL; /// line buffer
-  size_t len = 0;    /// line buffer length
-  ssize_t nread = 0; /// line bytes read
+  prev_blocks = blocks;
+  prev_cap = 16;
+  while (prev_cap < h->nblocks * 2)
+    prev_cap *= 2;
+  prev_index = calloc(prev_cap, sizeof(uint32_t));
+  assert(prev_index != NULL);
+  for (uint64_t k = 0; k < h->nblocks; ++k) {
+    if (find_block(blocks[k].hash) != NULL)
+      continue;
+    size_t i = blocks[k].hash & (prev_cap - 1);
+    while (prev_index[i] != 0)
+      i = (i + 1) & (prev_cap - 1);
+    prev_index[i] = k + 1;
+  }
+}
+
+static void free_previous(void)
+{
+  if (prev_mapped)
+    munmap(prev_data, prev_size);
+  else
+    free(prev_data);
+  if (prev_blocks_mapped)
+    munmap(prev_blocks_data, prev_blocks_size);
+  else
+    free(prev_blocks_data);
+  free(prev_index);
+  prev_data = prev_blocks_data = NULL;
+  prev_size = prev_blocks_size = 0;
+  prev_blocks = NULL;
+  prev_index = NULL;
+  prev_cap = 0;
+}
+
+/// Scan one input file and render it into job->out. Patterns and
+/// commands are rendered straight from the file contents.
+static void process(au_ctx_t *ctx, au_cache_t *cache, job_t *job)
+{
+  char *data;
+  size_t size;
+  bool mapped;
+  if (!load_input(job->path, &data, &size, &mapped)) {
+    fprintf(stderr, "%s: %s\n", job->path, strerror(errno));
+    return;
+  }
 
-  size_t patcap = 64; /// pattern buffer capacity
-  size_t cmdcap = 64; /// command buffer capacity
-  size_t cmdlen = 0;  /// command buffer length
-  char *patstr = malloc(patcap); /// pattern buffer
-  char *cmdstr = malloc(cmdcap); /// command buffer
-  assert(patstr != NULL);
-  assert(cmdstr != NULL);
+  au_buf_t *out = &job->out;
+  const char *file = opt_file ? job->path : NULL;
 
+  const char *pat = NULL; /// pattern of the pending autocmd
+  size_t patlen = 0;
+  const char *cmd = NULL; /// command of the pending autocmd, with continuation lines
+  const char *cmdend = NULL;
   size_t aulnum = 0;  /// autocmd source line number
-  bool inau = false; /// inside autocmd lines
-  bool comma = false; /// needs comma
+  bool inau = false;  /// inside autocmd lines
 
-#define SKIP_WHITESPACE \
+#define RENDER(PAT, PATLEN, CMD, CMDLEN, LNUM) \
     do { \
-      while (*it != '\0' && isspace(*it)) \
-        ++it; \
-      if (*it == '\0') \
-        continue; \
+      if (opt_binary) { \
+        render_binary(ctx, job, file, (PAT), (PATLEN), (CMD), (CMDLEN), (LNUM)); \
+      } else if (opt_json) { \
+        if (job->count++ > 0) \
+          au_buf_puts(out, opt_minify ? "," : ",\n"); \
+        render_block(ctx, cache, job, file, (PAT), (PATLEN), (CMD), (CMDLEN), (LNUM)); \
+      } else { \
+        parse(ctx, out, (PAT), (PATLEN)); \
+      } \
     } while (0)
 
-#define SKIP_TO_WHITESPACE \
+  const char *end = data + size;
+  const char *next = data;
+  for (size_t lnum = 1; next < end; ++lnum) {
+    const char *it = next;
+    const char *eol = memchr(it, '\n', end - it);
+    eol = eol != NULL ? eol : end;
+    next = eol < end ? eol + 1 : end;
+
+    it = skip_space(it, eol);
+
+    if (opt_raw_patterns) {
+      const char *p = it;
+      it = skip_to_space(it, eol);
+      RENDER(p, it - p, NULL, 0, aulnum);
+      continue;
+    }
+
+    if (it < eol && *it == 'a') {
+      if (inau)
+        RENDER(pat, patlen, cmd, cmdend - cmd, aulnum);
+      inau = false;
+
+      const char *au = it;
+      it = skip_to_space(it, eol);
+      if (!match_autocmd(au, it - au))
+        continue;
+
+      it = skip_space(it, eol);
+      const char *events = it;
+      it = skip_to_space(it, eol);
+      if (it == events || !match_events(events, it - events))
+        continue;
+
+      it = skip_space(it, eol);
+      if (it == eol)
+        continue;
+      pat = it;
+      it = skip_to_space(it, eol);
+      patlen = it - pat;
+
+      cmd = skip_space(it, eol);
+      cmdend = skip_to_newline(cmd, eol);
+      aulnum = lnum;
+      inau = true;
+    } else if (inau && it < eol && *it == '\\') {
+      cmdend = skip_to_newline(it, eol);
+    } else {
+      if (inau)
+        RENDER(pat, patlen, cmd, cmdend - cmd, aulnum);
+      inau = false;
+    }
+  }
+  if (inau)
+    RENDER(pat, patlen, cmd, cmdend - cmd, aulnum);
+
+#undef RENDER
+
+  if (mapped)
+    munmap(data, size);
+  else
+    free(data);
+  job->ok = true;
+}
+
+/// Write everything, retrying on partial writes
+static bool write_all(int fd, struct iovec *iov, int n)
+{
+  while (n > 0) {
+    ssize_t r = writev(fd, iov, n);
+    if (r < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    for (; n > 0 && (size_t)r >= iov->iov_len; ++iov, --n)
+      r -= iov->iov_len;
+    if (n > 0) {
+      iov->iov_base = (char *)iov->iov_base + r;
+      iov->iov_len -= r;
+    }
+  }
+  return true;
+}
+
+/// @param[in]  arg   au_bin_writer_t for cache entries, with opt_cache_dir
+static void *worker(void *arg)
+{
+  au_ctx_t ctx;
+  au_ctx_init(&ctx);
+  ctx.unroll_max = opt_unroll_max;
+  ctx.unroll_threads = unroll_threads;
+  au_cache_t cache;
+  au_cache_init(&cache);
+  if (store_open)
+    cache.store = &store;
+
+  pthread_mutex_lock(&jobs_lock);
+  while (next_job < njobs) {
+    job_t *job = &jobs[next_job++];
+    pthread_mutex_unlock(&jobs_lock);
+    process(&ctx, opt_cache ? &cache : NULL, job);
+    pthread_mutex_lock(&jobs_lock);
+    job->done = true;
+    pthread_cond_broadcast(&jobs_done);
+  }
+  cache_hits += cache.hits;
+  cache_misses += cache.misses;
+  cache_loaded += cache.loaded;
+  pthread_mutex_unlock(&jobs_lock);
+  if (opt_cache_dir != NULL)
+    au_cache_save(&cache, arg);
+  au_cache_free(&cache);
+  au_ctx_free(&ctx);
+  return NULL;
+}
+
+/// Temporary file next to path, to be renamed to it when complete
+static char *tmp_path(const char *path)
+{
+  size_t len = strlen(path) + 32;
+  char *tmp = malloc(len);
+  assert(tmp != NULL);
+  snprintf(tmp, len, "%s.tmp.%ld", path, (long)getpid());
+  return tmp;
+}
+
+/// Write file atomically: written to a temporary file first, and moved
+/// in place when it's complete
+static bool write_file(const char *path, au_buf_t *buf)
+{
+  char *tmp = tmp_path(path);
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  bool ok = fd >= 0;
+  if (ok) {
+    ok = au_buf_flush(buf, fd);
+    ok = close(fd) == 0 && ok;
+    ok = ok && rename(tmp, path) == 0;
+    if (!ok)
+      unlink(tmp);
+  }
+  free(tmp);
+  return ok;
+}
+
+/// Path to the store in the cache directory
+static char *store_path(void)
+{
+  size_t len = strlen(opt_cache_dir) + sizeof(STORE_NAME) + 1;
+  char *path = malloc(len);
+  assert(path != NULL);
+  snprintf(path, len, "%s/%s", opt_cache_dir, STORE_NAME);
+  return path;
+}
+
+/// Write out results in input order, as soon as they're ready. Buffers are
+/// collected and written together, until the next one isn't ready. In watch
+/// mode buffers are kept, otherwise they're freed once written.
+/// @param[out] blocks  block list with offsets in the whole output, with opt_incremental
+/// @return     false on errors
+static bool write_output(int outfd, au_buf_t *blocks)
+{
+  struct iovec iov[IOV_BATCH];
+  int niov = 0;
+  size_t nwritten = 0; /// jobs before this one are written out
+  bool ok = true;
+  bool comma = false;
+  uint64_t outsize = 0; /// bytes written so far
+  size_t reused = 0;
+  if (opt_incremental)
+    au_buf_put(blocks, (const char *)&(blocks_header_t){0}, sizeof(blocks_header_t));
+
+#define PUSH_IOV(DATA, LEN) \
     do { \
-      while (*it != '\0' && !isspace(*it)) \
-        ++it; \
+      iov[niov].iov_base = (void *)(DATA); \
+      iov[niov].iov_len = (LEN); \
+      outsize += iov[niov].iov_len; \
+      ++niov; \
     } while (0)
 
-#define SKIP_TO_NEWLINE \
+#define FLUSH_IOV() \
     do { \
-      while (*it != '\0' && *it != '\r' && *it != '\n') \
-        ++it; \
+      if (!write_all(outfd, iov, niov)) { \
+        if (ok) \
+          perror("write"); \
+        ok = false; \
+      } \
+      niov = 0; \
+      for (; nwritten < i; ++nwritten) { \
+        if (!opt_watch) \
+          au_buf_free(&jobs[nwritten].out); \
+      } \
     } while (0)
 
+  // binary output is merged and written at the end
+  au_bin_writer_t bin = {0};
+
+  size_t i = 0;
   if (opt_json)
-    printf("[\n");
-  if (opt_raw_patterns) {
-    for (size_t lnum = 1; (nread = getline(&line, &len, fp)) >= 0; ++lnum) {
-      char *it = line;
-      SKIP_WHITESPACE;
-      char *pat = it;
-      SKIP_TO_WHITESPACE;
-      *it = '\0';
-
-      if (opt_json) {
-        if (comma)
-          printf(",\n");
-        render_json(pat, NULL, aulnum);
-        comma = true;
-      } else {
-        parse(pat);
-      }
+    PUSH_IOV(opt_minify ? "[" : "[\n", opt_minify ? 1 : 2);
+  for (; i < njobs; ++i) {
+    job_t *job = &jobs[i];
+    pthread_mutex_lock(&jobs_lock);
+    if (!job->done) {
+      pthread_mutex_unlock(&jobs_lock);
+      FLUSH_IOV();
+      pthread_mutex_lock(&jobs_lock);
+      while (!job->done)
+        pthread_cond_wait(&jobs_done, &jobs_lock);
     }
-  } else {
-    for (size_t lnum = 1; (nread = getline(&line, &len, fp)) >= 0; ++lnum) {
-      char *it = line;
-      SKIP_WHITESPACE;
-
-      if (*it == 'a') {
-        if (inau) {
-          if (opt_json) {
-            if (comma)
-              printf(",\n");
-            escape_cmd(&cmdstr, &cmdcap);
-            render_json(patstr, cmdstr, aulnum);
-            comma = true;
-          } else {
-            parse(patstr);
-          }
-        }
-
-        char *au = it;
-        SKIP_TO_WHITESPACE;
-        *it = '\0';
-        if (!match_autocmd(au))
-          continue;
-        if (*(++it) == '\0')
-          continue;
-
-        SKIP_WHITESPACE;
-        char *events = it;
-        SKIP_TO_WHITESPACE;
-        *it = '\0';
-        if (!match_events(events))
-          continue;
-        if (*(++it) == '\0')
-          continue;
-
-        SKIP_WHITESPACE;
-        char *pat = it;
-        SKIP_TO_WHITESPACE;
-        *it = '\0';
-        size_t patlen = it - pat;
-        if (patlen >= patcap) {
-          free(patstr);
-          patstr = malloc(patlen + 1);
-          assert(patstr != NULL);
-        }
-        memcpy(patstr, pat, patlen);
-        patstr[patlen] = '\0';
-        if (*(++it) != '\0') {
-          SKIP_WHITESPACE;
-          char *cmd = it;
-          SKIP_TO_NEWLINE;
-          cmdlen = it - cmd;
-          if (cmdlen >= cmdcap) {
-            free(cmdstr);
-            cmdstr = malloc(cmdlen + 1);
-            assert(cmdstr != NULL);
-          }
-          memcpy(cmdstr, cmd, cmdlen);
-          cmdstr[cmdlen] = '\0';
-        } else {
-          cmdlen = 0;
-        }
+    pthread_mutex_unlock(&jobs_lock);
 
-        aulnum = lnum;
-        inau = true;
-      } else if (inau && *it == '\\') {
-        ++it;
-        SKIP_WHITESPACE;
-        char *cmd = it;
-        SKIP_TO_NEWLINE;
-        size_t len = it - cmd;
-        if (cmdlen + len >= cmdcap) {
-          char *buf = realloc(cmdstr, cmdlen + len + 1);
-          assert(buf != NULL);
-          cmdstr = buf;
-        }
-        memcpy(cmdstr + cmdlen, cmd, len);
-        cmdlen = cmdlen + len;
-        cmdstr[cmdlen] = '\0';
-      } else {
-        if (inau) {
-          if (opt_json) {
-            if (comma)
-              printf(",\n");
-            escape_cmd(&cmdstr, &cmdcap);
-            render_json(patstr, cmdstr, aulnum);
-            comma = true;
-          } else {
-            parse(patstr);
-          }
+    if (opt_binary) {
+      // in watch mode job output is kept for writing the output again
+      if (opt_watch)
+        au_bin_append_copy(&bin, &job->bin);
+      else
+        au_bin_append(&bin, &job->bin);
+    } else {
+      if (niov + 2 > IOV_BATCH)
+        FLUSH_IOV();
+      if (opt_json && comma && job->count > 0)
+        PUSH_IOV(opt_minify ? "," : ",\n", opt_minify ? 1 : 2);
+      if (job->blocks.size > 0) {
+        size_t base = blocks->size;
+        au_buf_put(blocks, job->blocks.data, job->blocks.size);
+        if (!blocks->failed) {
+          block_t *b = (block_t *)(blocks->data + base);
+          for (size_t k = 0; k < job->blocks.size / sizeof(block_t); ++k)
+            b[k].off += outsize;
         }
-        cmdlen = 0;
-        inau = false;
       }
+      if (!opt_watch)
+        au_buf_free(&job->blocks);
+      reused += job->reused;
+      PUSH_IOV(job->out.data, job->out.size);
+      comma = comma || job->count > 0;
     }
-    if (inau) {
-      if (opt_json) {
-        if (comma)
-          printf(",\n");
-        escape_cmd(&cmdstr, &cmdcap);
-        render_json(patstr, cmdstr, aulnum);
-        comma = true;
-      } else {
-        parse(patstr);
-      }
+    if (job->out.failed) {
+      fprintf(stderr, "%s: out of memory\n", job->path);
+      job->ok = false;
     }
+    ok = ok && job->ok;
   }
   if (opt_json)
-    printf("\n]\n");
-
-  free(patstr);
-  free(cmdstr);
-  free(line);
-  if (fp != stdin)
-    fclose(fp);
-  return EXIT_SUCCESS;
+    PUSH_IOV(opt_minify ? "]\n" : "\n]\n", opt_minify ? 2 : 3);
+  FLUSH_IOV();
+
+  if (opt_binary) {
+    au_buf_t out = {0};
+    if (!au_bin_finish(&bin, &out)) {
+      fprintf(stderr, "binary output: out of memory\n");
+      ok = false;
+    } else if (!au_buf_flush(&out, outfd)) {
+      perror("write");
+      ok = false;
+    }
+    au_buf_free(&out);
+    au_bin_free(&bin);
+  }
+
+#undef PUSH_IOV
+#undef FLUSH_IOV
+
+  if (opt_incremental) {
+    size_t nblocks = (blocks->size - sizeof(blocks_header_t)) / sizeof(block_t);
+    blocks_reused = reused;
+    blocks_total = nblocks;
+    blocks_header_t h = {
+      .version = BLOCKS_VERSION,
+      .options = options_fingerprint(),
+      .outsize = outsize,
+      .nblocks = nblocks,
+    };
+    memcpy(h.magic, BLOCKS_MAGIC, sizeof(h.magic));
+    if (!blocks->failed)
+      memcpy(blocks->data, &h, sizeof(h));
+  }
+  return ok;
+}
+
+/// Write output to a temporary file and move it in place of opt_output
+/// when it's complete. Block list goes next to it, it's only valid with it.
+static bool write_output_file(void)
+{
+  char *tmp = tmp_path(opt_output);
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "%s: %s\n", tmp, strerror(errno));
+    free(tmp);
+    return false;
+  }
+
+  au_buf_t blocks = {0};
+  bool ok = write_output(fd, &blocks);
+  ok = close(fd) == 0 && ok;
+  if (ok && rename(tmp, opt_output) != 0) {
+    fprintf(stderr, "%s: %s\n", opt_output, strerror(errno));
+    ok = false;
+  }
+  if (!ok)
+    unlink(tmp);
+  free(tmp);
+
+  if (opt_incremental) {
+    size_t len = strlen(opt_output) + sizeof(BLOCKS_SUFFIX);
+    char *bpath = malloc(len);
+    assert(bpath != NULL);
+    snprintf(bpath, len, "%s%s", opt_output, BLOCKS_SUFFIX);
+    if (ok && !write_file(bpath, &blocks)) {
+      fprintf(stderr, "%s: writing blocks failed\n", bpath);
+      ok = false;
+    }
+    free(bpath);
+  }
+  au_buf_free(&blocks);
+  return ok;
+}
+
+/// Directory of a file, "." if it doesn't have one
+static char *parent_dir(const char *path)
+{
+  const char *slash = strrchr(path, '/');
+  char *dir = slash == NULL ? strdup(".") : strndup(path, slash == path ? 1 : (size_t)(slash - path));
+  assert(dir != NULL);
+  return dir;
+}
+
+/// Mark jobs of a changed file, or all of them if name is NULL
+/// @return     true if any job was marked
+static bool mark_changed(int wd, const char *name)
+{
+  bool changed = false;
+  for (size_t i = 0; i < njobs; ++i) {
+    job_t *job = &jobs[i];
+    if (job->wd < 0)
+      continue;
+    const char *base = strrchr(job->path, '/');
+    base = base != NULL ? base + 1 : job->path;
+    if (name == NULL || (job->wd == wd && strcmp(base, name) == 0)) {
+      job->changed = true;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+static double elapsed_ms(const struct timespec *start)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (t.tv_sec - start->tv_sec) * 1e3 + (t.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+/// Parse changed files again and rewrite the output. Output of the other
+/// files is kept from the previous run.
+static void rebuild(au_ctx_t *ctx, au_cache_t *cache)
+{
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  size_t nchanged = 0;
+  for (size_t i = 0; i < njobs; ++i) {
+    job_t *job = &jobs[i];
+    if (!job->changed)
+      continue;
+    job->changed = false;
+    au_buf_free(&job->out);
+    au_buf_free(&job->blocks);
+    au_bin_free(&job->bin);
+    job->count = 0;
+    job->reused = 0;
+    job->ok = false;
+    process(ctx, cache, job);
+    ++nchanged;
+  }
+
+  if (!write_output_file())
+    fprintf(stderr, "%s: not updated\n", opt_output);
+  else if (opt_stats)
+    fprintf(stderr, "watch: %zu changed files parsed, output written in %.2f ms\n", nchanged, elapsed_ms(&start));
+}
+
+/// Watch input files and rewrite the output when they change
+/// @return     false if watching failed, doesn't return otherwise
+static bool watch(void)
+{
+  int fd = inotify_init1(IN_CLOEXEC);
+  if (fd < 0) {
+    perror("inotify");
+    return false;
+  }
+
+  // editors often replace files instead of writing to them, which drops
+  // watches on the files. parent directories are watched instead, and
+  // events are matched to inputs by file name
+  for (size_t i = 0; i < njobs; ++i) {
+    job_t *job = &jobs[i];
+    job->wd = -1;
+    if (strcmp(job->path, "-") == 0)
+      continue;
+    char *dir = parent_dir(job->path);
+    job->wd = inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE);
+    if (job->wd < 0)
+      fprintf(stderr, "%s: %s\n", dir, strerror(errno));
+    free(dir);
+  }
+
+  au_ctx_t ctx;
+  au_ctx_init(&ctx);
+  ctx.unroll_max = opt_unroll_max;
+  ctx.unroll_threads = opt_jobs;
+  au_cache_t cache;
+  au_cache_init(&cache);
+  if (store_open)
+    cache.store = &store;
+
+  char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  int timeout = -1; /// waiting for more changes before rebuilding
+  for (;;) {
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    int r = poll(&pfd, 1, timeout);
+    if (r < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("poll");
+      break;
+    }
+    if (r == 0) {
+      rebuild(&ctx, opt_cache ? &cache : NULL);
+      timeout = -1;
+      continue;
+    }
+
+    ssize_t len = read(fd, buf, sizeof(buf));
+    if (len < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("read");
+      break;
+    }
+    for (const char *p = buf; p < buf + len; ) {
+      const struct inotify_event *ev = (const struct inotify_event *)p;
+      // events were lost, anything could have changed
+      if ((ev->mask & IN_Q_OVERFLOW) ? mark_changed(-1, NULL) : ev->len > 0 && mark_changed(ev->wd, ev->name))
+        timeout = WATCH_DELAY;
+      p += sizeof(struct inotify_event) + ev->len;
+    }
+  }
+
+  au_cache_free(&cache);
+  au_ctx_free(&ctx);
+  close(fd);
+  return false;
+}
+
+int main(int argc, char *argv[])
+{
+  assert(argc > 0);
+  progname = argv[0];
+  parse_options(argc, argv);
+
+  char *spath = NULL;
+  if (opt_cache_dir != NULL) {
+    spath = store_path();
+    const char *error;
+    store_open = au_store_open(&store, spath, &error);
+    if (!store_open && strcmp(error, AU_STORE_MISSING) != 0)
+      fprintf(stderr, "%s: ignoring cache: %s\n", spath, error);
+  }
+
+  if (opt_incremental)
+    load_previous(opt_output);
+
+  if (opt_jobs == 0) {
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    opt_jobs = ncpus > 0 ? ncpus : 1;
+  }
+  // threads are either split between files, or a single file gets
+  // all of them for unrolling big patterns
+  size_t nworkers = opt_jobs;
+  if (nworkers > njobs)
+    nworkers = njobs;
+  unroll_threads = nworkers > 1 ? 1 : opt_jobs;
+
+  pthread_t *threads = malloc(nworkers * sizeof(pthread_t));
+  au_bin_writer_t *writers = calloc(nworkers, sizeof(au_bin_writer_t));
+  assert(threads != NULL && writers != NULL);
+  for (size_t i = 0; i < nworkers; ++i) {
+    int r = pthread_create(&threads[i], NULL, worker, &writers[i]);
+    assert(r == 0);
+    (void)r;
+  }
+
+  // output is written while workers are still busy with the next files
+  bool ok;
+  if (opt_output != NULL) {
+    ok = write_output_file();
+  } else {
+    au_buf_t blocks = {0};
+    ok = write_output(STDOUT_FILENO, &blocks);
+    au_buf_free(&blocks);
+  }
+  if (opt_incremental) {
+    if (opt_stats)
+      fprintf(stderr, "incremental: %zu of %zu blocks reused\n", blocks_reused, blocks_total);
+    free_previous();
+  }
+
+  for (size_t i = 0; i < nworkers; ++i)
+    pthread_join(threads[i], NULL);
+  free(threads);
+  if (opt_stats && opt_cache) {
+    fprintf(stderr, "cache: %zu hits, %zu misses, %zu loaded from %s\n",
+        cache_hits, cache_misses, cache_loaded, spath != NULL ? spath : "-");
+  }
+
+  // when something wasn't found in the store, everything used in this
+  // run replaces it
+  if (opt_cache_dir != NULL && (!store_open || cache_loaded < cache_misses)) {
+    for (size_t i = 1; i < nworkers; ++i)
+      au_bin_append(&writers[0], &writers[i]);
+    au_buf_t out = {0};
+    if (nworkers > 0 && (!au_bin_finish(&writers[0], &out) || !write_file(spath, &out)))
+      fprintf(stderr, "%s: writing cache failed: %s\n", spath, strerror(errno));
+    au_buf_free(&out);
+  }
+  for (size_t i = 0; i < nworkers; ++i)
+    au_bin_free(&writers[i]);
+  free(writers);
+
+  if (opt_watch)
+    ok = watch() && ok;
+
+  for (size_t i = 0; i < njobs; ++i) {
+    au_buf_free(&jobs[i].out);
+    au_buf_free(&jobs[i].blocks);
+    au_bin_free(&jobs[i].bin);
+    free(jobs[i].path);
+  }
+  if (store_open)
+    au_store_close(&store);
+  free(spath);
+  free(jobs);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -1,6 +1,10 @@
 #include "auparser.h"
 #include "bdd-for-c.h"
 #include <assert.h>
+#include <stdint.h>
+#include <unistd.h>
+
+static au_ctx_t ctx;
 
 typedef struct {
   type_t type;
@@ -12,18 +16,18 @@ typedef struct {
 
 static bool tok_fail(const char *pat)
 {
-  token_t *tokens = tokenize(pat);
+  token_t *tokens = tokenize(&ctx, pat);
   if (tokens == NULL)
     return true;
-  free(tokens);
+  au_ctx_reset(&ctx);
   return false;
 }
 
 static bool tok_ok(const char *input, tok_case *expected)
 {
-  token_t *tokens = tokenize(input);
+  token_t *tokens = tokenize(&ctx, input);
   if (tokens == NULL) {
-    fprintf(stderr, "tokenizing failed: %s\n", error);
+    fprintf(stderr, "tokenizing failed: %s\n", ctx.error);
     return false;
   }
 
@@ -62,45 +66,109 @@ static bool tok_ok(const char *input, tok_case *expected)
     }
   }
 
-  free(tokens);
+  au_ctx_reset(&ctx);
   return true;
 
 fail:
-  free(tokens);
+  au_ctx_reset(&ctx);
   return false;
 }
 
 static bool unroll_fail(const char *input)
 {
-  token_t *tokens = tokenize(input);
+  token_t *tokens = tokenize(&ctx, input);
   if (tokens == NULL) {
-    fprintf(stderr, "tokenizing failed: %s\n", error);
+    fprintf(stderr, "tokenizing failed: %s\n", ctx.error);
     return false;
   }
 
-  const token_t ***res = unroll(tokens);
+  const token_t ***res = unroll(&ctx, tokens);
   if (res == NULL) {
-    free(tokens);
+    au_ctx_reset(&ctx);
     return true;
   }
 
-  free_tokens(res);
-  free(tokens);
+  au_ctx_reset(&ctx);
   return false;
 }
 
+/// Items left to walk in factorized sequences, innermost first
+typedef struct dag_rest {
+  const uint32_t *it;
+  const uint32_t *end;
+  const struct dag_rest *next;
+} dag_rest_t;
+
+typedef struct {
+  const au_dag_t *dag;
+  const token_t ***res;   /// expected branches
+  size_t count;           /// branches produced so far
+  const token_t *path[256];
+  bool ok;
+} dag_walk_t;
+
+/// Produce every branch of factorized sequences and compare them with unroll results
+static void dag_walk(dag_walk_t *w, const dag_rest_t *r, size_t n)
+{
+  while (r != NULL && r->it == r->end)
+    r = r->next;
+  if (r == NULL) {
+    const token_t **exp = w->res[w->count++];
+    if (exp == NULL) {
+      w->ok = false;
+      return;
+    }
+    for (size_t i = 0; i < n; ++i)
+      w->ok = w->ok && exp[i] == w->path[i];
+    w->ok = w->ok && exp[n] == NULL;
+    return;
+  }
+
+  dag_rest_t next = { r->it + 1, r->end, r->next };
+  if (*r->it & AU_DAG_GROUP) {
+    const au_dag_group_t *g = &w->dag->groups[*r->it & ~AU_DAG_GROUP];
+    for (uint32_t k = g->seqs; w->ok && k < g->seqs + g->nseqs; ++k) {
+      const au_dag_seq_t *seq = &w->dag->seqs[k];
+      dag_rest_t alt = { w->dag->items + seq->items, w->dag->items + seq->items + seq->nitems, &next };
+      dag_walk(w, &alt, n);
+    }
+  } else if (n < sizeof(w->path) / sizeof(w->path[0])) {
+    w->path[n] = &w->dag->toks[*r->it];
+    dag_walk(w, &next, n + 1);
+  } else {
+    w->ok = false;
+  }
+}
+
+static bool dag_same(const token_t *tokens, const token_t ***res)
+{
+  au_dag_t dag;
+  if (!au_unroll_dag(&ctx, tokens, &dag)) {
+    fprintf(stderr, "factorized unroll failed: %s\n", ctx.error);
+    return false;
+  }
+  dag_walk_t w = { .dag = &dag, .res = res, .ok = true };
+  uint32_t root = AU_DAG_GROUP | (dag.ngroups - 1);
+  dag_walk(&w, &(dag_rest_t){ &root, &root + 1, NULL }, 0);
+  if (!w.ok || res[w.count] != NULL) {
+    fprintf(stderr, "factorized unroll has different branches\n");
+    return false;
+  }
+  return true;
+}
+
 static bool unroll_ok(const char *input, const char **expected)
 {
-  token_t *tokens = tokenize(input);
+  token_t *tokens = tokenize(&ctx, input);
   if (tokens == NULL) {
-    fprintf(stderr, "tokenizing failed: %s\n", error);
+    fprintf(stderr, "tokenizing failed: %s\n", ctx.error);
     return false;
   }
 
-  const token_t ***res = unroll(tokens);
+  const token_t ***res = unroll(&ctx, tokens);
   if (res == NULL) {
-    fprintf(stderr, "unrolling failed: %s\n", error);
-    free(tokens);
+    fprintf(stderr, "unrolling failed: %s\n", ctx.error);
+    au_ctx_reset(&ctx);
     return false;
   }
 
@@ -136,16 +204,163 @@ static bool unroll_ok(const char *input, const char **expected)
     }
   }
 
-  free_tokens(res);
-  free(tokens);
+  // iterator has to produce the same branches
+  au_unroll_t it;
+  const token_t **branch;
+  if (!au_unroll_init(&ctx, &it, tokens)) {
+    fprintf(stderr, "iterator failed: %s\n", ctx.error);
+    goto fail;
+  }
+  for (size_t i = 0;; ++i) {
+    if (!au_unroll_next(&it, &branch)) {
+      fprintf(stderr, "iterator failed: %s\n", ctx.error);
+      goto fail;
+    }
+    if (branch == NULL && res[i] == NULL)
+      break;
+    if (branch == NULL || res[i] == NULL) {
+      fprintf(stderr, "iterator produced a different number of results\n");
+      goto fail;
+    }
+    for (size_t j = 0; branch[j] != NULL || res[i][j] != NULL; ++j) {
+      if (branch[j] != res[i][j]) {
+        fprintf(stderr, "iterator produced a different result at index %ld\n", i);
+        goto fail;
+      }
+    }
+  }
+
+  // and the factorized form
+  if (!dag_same(tokens, res))
+    goto fail;
+
+  au_ctx_reset(&ctx);
   return true;
 
 fail:
-  free_tokens(res);
-  free(tokens);
+  au_ctx_reset(&ctx);
+  return false;
+}
+
+/// Unroll on multiple threads and compare with a single thread
+static bool unroll_parallel_same(const char *pat)
+{
+  token_t *tokens = tokenize(&ctx, pat);
+  if (tokens == NULL) {
+    fprintf(stderr, "tokenizing failed: %s\n", ctx.error);
+    return false;
+  }
+  size_t count;
+  au_branches_t br, pbr;
+  bool ok = au_unroll_count(&ctx, tokens, &count) && count >= AU_UNROLL_PARALLEL_MIN
+    && au_unroll_flat(&ctx, tokens, &br);
+  ctx.unroll_threads = 4;
+  ok = ok && au_unroll_flat(&ctx, tokens, &pbr);
+  ctx.unroll_threads = 0;
+  if (!ok) {
+    fprintf(stderr, "unrolling failed: %s\n", ctx.error);
+  } else if (br.nbranches != pbr.nbranches
+      || memcmp(br.offs, pbr.offs, (br.nbranches + 1) * sizeof(uint32_t)) != 0
+      || memcmp(br.refs, pbr.refs, br.offs[br.nbranches] * sizeof(uint32_t)) != 0) {
+    fprintf(stderr, "parallel unroll produced different results\n");
+    ok = false;
+  }
+  au_ctx_reset(&ctx);
+  return ok;
+}
+
+static size_t unroll_count(const char *pat)
+{
+  size_t count = 0;
+  token_t *tokens = tokenize(&ctx, pat);
+  if (tokens == NULL) {
+    fprintf(stderr, "tokenizing failed: %s\n", ctx.error);
+  } else if (!au_unroll_count(&ctx, tokens, &count)) {
+    fprintf(stderr, "counting failed: %s\n", ctx.error);
+  }
+  au_ctx_reset(&ctx);
+  return count;
+}
+
+static bool match(const char *pat, const char *path)
+{
+  token_t *tokens = tokenize(&ctx, pat);
+  if (tokens == NULL) {
+    fprintf(stderr, "tokenizing failed: %s\n", ctx.error);
+    return false;
+  }
+
+  au_prog_t *prog = au_compile(&ctx, tokens);
+  if (prog == NULL) {
+    fprintf(stderr, "compiling failed: %s\n", ctx.error);
+    au_ctx_reset(&ctx);
+    return false;
+  }
+
+  bool res = au_match(prog, path, strlen(path));
+  au_free_prog(prog);
+  au_ctx_reset(&ctx);
+  return res;
+}
+
+static bool compile_fail(const char *pat)
+{
+  token_t *tokens = tokenize(&ctx, pat);
+  if (tokens == NULL) {
+    fprintf(stderr, "tokenizing failed: %s\n", ctx.error);
+    return false;
+  }
+
+  au_prog_t *prog = au_compile(&ctx, tokens);
+  au_ctx_reset(&ctx);
+  if (prog == NULL)
+    return true;
+  au_free_prog(prog);
   return false;
 }
 
+/// Match path against set of patterns
+/// @return     1-based index of the first matching pattern, 0 if none matched
+static size_t set_match(const char **pats, const char *path)
+{
+  au_set_t *set = au_set_new();
+  assert(set != NULL);
+  size_t res = 0;
+
+  for (size_t i = 0; pats[i] != NULL; ++i) {
+    token_t *tokens = tokenize(&ctx, pats[i]);
+    if (tokens == NULL) {
+      fprintf(stderr, "tokenizing failed: %s\n", ctx.error);
+      goto end;
+    }
+    bool ok = au_set_add(&ctx, set, tokens, i + 1, pats[i]);
+    au_ctx_reset(&ctx);
+    if (!ok) {
+      fprintf(stderr, "compiling failed: %s\n", ctx.error);
+      goto end;
+    }
+  }
+
+  // match twice, to go through cached transitions too
+  const au_rule_t *rule = au_set_match(set, path, strlen(path));
+  const au_rule_t *rule2 = au_set_match(set, path, strlen(path));
+  const au_rule_t *rule3 = au_set_match_prefiltered(set, path, strlen(path));
+  if (rule != rule2) {
+    fprintf(stderr, "cached result is different\n");
+    res = (size_t)-1;
+  } else if (rule != rule3) {
+    fprintf(stderr, "prefiltered result is different\n");
+    res = (size_t)-1;
+  } else if (rule != NULL) {
+    assert(strcmp(rule->cmd, pats[rule->lnum - 1]) == 0);
+    res = rule->lnum;
+  }
+
+end:
+  au_set_free(set);
+  return res;
+}
+
 spec("auparser")
 {
   describe("tokenize") {
@@ -287,6 +502,21 @@ spec("auparser")
       check(tok_fail("\\\\\\\\"));
     }
 
+    it("should tokenize patterns that aren't null terminated") {
+      const char *line = "*.{c,h} setf c";
+      token_t *tokens = tokenize_n(&ctx, line, 7);
+      check(tokens != NULL);
+      size_t n = 0;
+      while (tokens[n].type)
+        ++n;
+      check(n == 7);
+      check(tokens[5].type == Literal && tokens[5].len == 1 && *tokens[5].beg == 'h');
+      check(tokens[6].type == Pop);
+      check(tokenize_n(&ctx, "{a,b}", 4) == NULL);
+      check(strcmp(ctx.error, "unclosed branch") == 0);
+      au_ctx_reset(&ctx);
+    }
+
     describe("branching") {
       it("should tokenize branches at the root level") {
         check(tok_ok("a,b", (tok_case[]){
@@ -434,6 +664,48 @@ spec("auparser")
         check(tok_fail("}{}"));
       }
 
+      it("should fail when levels don't fit in a token") {
+        size_t n = UINT16_MAX + 1;
+        char *pat = malloc(n * 2 + 1);
+        assert(pat != NULL);
+        memset(pat, '{', n);
+        memset(pat + n, '}', n);
+        pat[n * 2] = '\0';
+        check(tok_fail(pat));
+        pat[n * 2 - 1] = '\0';
+        check(tokenize(&ctx, pat + 1) != NULL);
+        au_ctx_reset(&ctx);
+        free(pat);
+      }
+
+      it("should link groups") {
+        const char *pat = "a{b,{c,d},e}f";
+        au_jump_t *jumps;
+        token_t *tokens = tokenize_jumps(&ctx, pat, strlen(pat), &jumps);
+        check(tokens != NULL && tokens[1].type == Push && tokens[4].type == Push);
+        check(jumps[1].next == 3 && jumps[3].next == 9 && jumps[9].next == 11);
+        check(jumps[1].pop == 11 && jumps[3].pop == 11 && jumps[9].pop == 11);
+        check(jumps[4].next == 6 && jumps[6].next == 8);
+        check(jumps[4].pop == 8 && jumps[6].pop == 8);
+
+        // unrolls the same with them
+        au_unroll_t it;
+        const token_t **branch;
+        const char *expected[] = { "abf", "acf", "adf", "aef" };
+        check(au_unroll_init_jumps(&ctx, &it, tokens, jumps) && it.jumps == jumps);
+        for (size_t i = 0; i < 4; ++i) {
+          check(au_unroll_next(&it, &branch) && branch != NULL);
+          char buf[8];
+          size_t n = 0;
+          for (const token_t **t = branch; *t != NULL; ++t)
+            buf[n++] = *(*t)->beg;
+          buf[n] = '\0';
+          check(strcmp(buf, expected[i]) == 0);
+        }
+        check(au_unroll_next(&it, &branch) && branch == NULL);
+        au_ctx_reset(&ctx);
+      }
+
       it("should tokenize vim regex groups") {
         check(tok_ok("\\(a\\)", (tok_case[]){
           { Push, "\\(", 1 },
@@ -719,8 +991,911 @@ spec("auparser")
       }));
     }
 
-    it("should fail on too deeply nested branches") {
-      check(unroll_fail("{{{{{{{{{{a}}}}}}}}}}"));
+    it("should continue after a nested branch in an alternative") {
+      check(unroll_ok("{a{b,x}d,e}c", (const char*[]){
+        "abdc",
+        "axdc",
+        "ec",
+        NULL,
+      }));
+      check(unroll_ok("{*{,?{}b},}*", (const char*[]){
+        "**",
+        "*?b*",
+        "*",
+        NULL,
+      }));
+    }
+
+    it("should unroll deeply nested branches without a limit") {
+      check(unroll_ok("{{{{{{{{{{a,b}}}}}}}}},c}", (const char*[]){
+        "a",
+        "b",
+        "c",
+        NULL,
+      }));
+    }
+
+    it("should unroll long branches") {
+      char pat[1024 + 6];
+      memset(pat, '?', 1024);
+      memcpy(pat + 1024, "{a,b}", 6);
+      token_t *tokens = tokenize(&ctx, pat);
+      check(tokens != NULL);
+      const token_t ***res = unroll(&ctx, tokens);
+      check(res != NULL && res[0] != NULL && res[1] != NULL && res[2] == NULL);
+      check(*res[1][1023]->beg == '?' && *res[1][1024]->beg == 'b' && res[1][1025] == NULL);
+      au_ctx_reset(&ctx);
+    }
+
+    it("should produce branches one at a time") {
+      // 4^12 branches, only the first few are produced
+      token_t *tokens = tokenize(&ctx,
+          "{a,b,c,d}{a,b,c,d}{a,b,c,d}{a,b,c,d}{a,b,c,d}{a,b,c,d}"
+          "{a,b,c,d}{a,b,c,d}{a,b,c,d}{a,b,c,d}{a,b,c,d}{a,b,c,d}");
+      check(tokens != NULL);
+      au_unroll_t it;
+      const token_t **branch;
+      check(au_unroll_init(&ctx, &it, tokens));
+      const char *expected[] = { "aaaaaaaaaaaa", "aaaaaaaaaaab", "aaaaaaaaaaac",
+        "aaaaaaaaaaad", "aaaaaaaaaaba" };
+      for (size_t i = 0; i < 5; ++i) {
+        check(au_unroll_next(&it, &branch) && branch != NULL);
+        char buf[16];
+        size_t n = 0;
+        for (const token_t **p = branch; *p != NULL; ++p)
+          buf[n++] = *(*p)->beg;
+        buf[n] = '\0';
+        check(strcmp(buf, expected[i]) == 0);
+      }
+      au_ctx_reset(&ctx);
+    }
+
+    it("should unroll into a flat list of branches") {
+      token_t *tokens = tokenize(&ctx, "x{a,b{c,d}},y");
+      check(tokens != NULL);
+      au_branches_t br;
+      check(au_unroll_flat(&ctx, tokens, &br));
+      check(br.toks == tokens && br.nbranches == 4);
+      const char *expected[] = { "xa", "xbc", "xbd", "y" };
+      for (size_t i = 0; i < br.nbranches; ++i) {
+        char buf[8];
+        size_t n = 0;
+        for (uint32_t k = br.offs[i]; k < br.offs[i + 1]; ++k)
+          n += snprintf(buf + n, sizeof(buf) - n, "%.*s", (int)tokens[br.refs[k]].len, tokens[br.refs[k]].beg);
+        check(strcmp(buf, expected[i]) == 0);
+      }
+
+      const token_t ***res = au_branches_expand(&ctx.arena, &br, tokens);
+      check(res != NULL && res[4] == NULL);
+      check(res[2][0] == &tokens[0] && *res[2][2]->beg == 'd' && res[2][3] == NULL);
+      au_ctx_reset(&ctx);
+    }
+
+    it("should unroll big patterns in parallel") {
+      check(unroll_parallel_same("{a,b,c,d}{a,b,c,d}{a,b,c,d}{a,b,c,d}{a,b,c,d}{a,b,c,d}"));
+      check(unroll_parallel_same(",x{a,b{c,d},}{e,f}{g,,h}{i,j}{k{l},m}{n,o,p}{q,r}{s,t}{u,v}{w,x}{y,z},{a,b},"));
+      check(unroll_parallel_same("{{a,b}{c,d}{e,f},g}{{a,b}{c,d}{e,f},g}{{a,b}{c,d}{e,f},g}{{a,b}{c,d}{e,f},g}{{a,b}{c,d},}"));
+      check(unroll_parallel_same("a,b,c,{a,b}{c,d}{e,f}{g,h}{i,j}{k,l}{m,n}{o,p}{q,r}{s,t}{u,v}{w,x},d,e"));
+      check(unroll_parallel_same("{a}{b}{c}{{d}}{{a,b,c,d,e,f,g,h}{a,b,c,d,e,f,g,h}{a,b,c,d,e,f,g,h}{a,b,c,d,e,f,g,h}}"));
+    }
+
+    it("should refuse to unroll in parallel past the limit") {
+      token_t *tokens = tokenize(&ctx, "{a,b,c,d}{a,b,c,d}{a,b,c,d}{a,b,c,d}{a,b,c,d}{a,b,c,d}");
+      check(tokens != NULL);
+      au_branches_t br;
+      ctx.unroll_threads = 4;
+      ctx.unroll_max = 4095;
+      check(!au_unroll_flat(&ctx, tokens, &br) && br.offs == NULL);
+      check(strcmp(ctx.error, "too many branches") == 0);
+      ctx.unroll_max = 0;
+      const token_t ***res = unroll(&ctx, tokens);
+      check(res != NULL && res[4095] != NULL && res[4096] == NULL);
+      ctx.unroll_threads = 0;
+      au_ctx_reset(&ctx);
+    }
+
+    it("should not unroll anything when it fails from the start") {
+      token_t *tokens = tokenize(&ctx, "a,{b,c}");
+      check(tokens != NULL);
+      au_branches_t br;
+      ctx.unroll_max = 2;
+      check(!au_unroll_flat(&ctx, tokens, &br) && br.offs == NULL);
+      ctx.unroll_max = 0;
+      au_ctx_reset(&ctx);
+    }
+  }
+
+  describe("unroll count") {
+    it("should count branches without unrolling") {
+      check(unroll_count("a") == 1);
+      check(unroll_count("a,b,c") == 3);
+      check(unroll_count(",a,") == 1);
+      check(unroll_count("{,}") == 2);
+      check(unroll_count("a{b,c}d{e,f{g,h}}i") == 6);
+      check(unroll_count("{a{b,x}d,e}c") == 3);
+      check(unroll_count("a,{.,}b,c") == 4);
+    }
+
+    it("should saturate on overflow") {
+      char pat[64 * 5 + 1] = {0};
+      for (size_t i = 0; i < 64; ++i)
+        strcat(pat, "{a,b}");
+      check(unroll_count(pat) == SIZE_MAX);
+    }
+
+    it("should refuse to unroll more branches than the limit") {
+      ctx.unroll_max = 4;
+      check(!unroll_fail("{a,b}{c,d}"));
+      check(unroll_fail("{a,b}{c,d},e"));
+      check(strcmp(ctx.error, "too many branches") == 0);
+      ctx.unroll_max = 0;
+    }
+  }
+
+  describe("factorized unroll") {
+    it("should share groups instead of expanding them") {
+      // 2^20 branches
+      char pat[128] = "";
+      for (int i = 0; i < 20; ++i)
+        strcat(pat, "{a,b}");
+      token_t *tokens = tokenize(&ctx, pat);
+      au_dag_t dag;
+      check(tokens != NULL && au_unroll_dag(&ctx, tokens, &dag));
+      check(dag.ngroups == 21 && dag.nseqs == 41 && dag.nitems == 60);
+      const au_dag_group_t *root = &dag.groups[dag.ngroups - 1];
+      check(root->nseqs == 1 && dag.seqs[root->seqs].nitems == 20);
+      check(dag.items[dag.seqs[root->seqs].items] == (AU_DAG_GROUP | 0));
+      au_ctx_reset(&ctx);
+    }
+
+    it("should leave out empty root branches and empty tokens") {
+      token_t *tokens = tokenize(&ctx, ",a{,b},");
+      au_dag_t dag;
+      check(tokens != NULL && au_unroll_dag(&ctx, tokens, &dag));
+      check(dag.ngroups == 2 && dag.nseqs == 3 && dag.nitems == 3);
+      check(dag.groups[1].nseqs == 1);
+      check(dag.groups[0].nseqs == 2 && dag.seqs[dag.groups[0].seqs].nitems == 0);
+      au_ctx_reset(&ctx);
+    }
+
+    it("should not limit nesting") {
+      token_t *tokens = tokenize(&ctx, "{{{{{{{{{{{{a,b}}}}}}}}}}}}");
+      au_dag_t dag;
+      check(tokens != NULL && au_unroll_dag(&ctx, tokens, &dag));
+      check(dag.ngroups == 13);
+      au_ctx_reset(&ctx);
+    }
+  }
+
+  describe("match") {
+    it("should match literals") {
+      check(match("Makefile", "Makefile"));
+      check(!match("Makefile", "Makefile.in"));
+      check(!match("Makefile", "makefile"));
+      check(match("a\\,b", "a,b"));
+      check(match("a\\{b\\}", "a{b}"));
+    }
+
+    it("should match * and ?") {
+      check(match("*.json", "a.json"));
+      check(match("*.json", ".json"));
+      check(!match("*.json", "a.jsonc"));
+      check(match("a?c", "abc"));
+      check(!match("a?c", "ac"));
+      check(match("*", ""));
+    }
+
+    it("should match the tail of the path when there is no slash") {
+      check(match("*.json", "/home/user/a.json"));
+      check(match("Makefile", "/src/Makefile"));
+      check(!match("Makefile", "/src/Makefile/x"));
+      check(match("a*", "/x/a"));
+      check(!match("a*", "/x/a/b"));
+      check(match("a*", "x/ab"));
+      check(!match("a*", "a/b/c"));
+      check(!match("*vimrc*", "/etc/vimrc.d/foo.lua"));
+      check(match("*vimrc*", "/etc/vimrc.d/vimrc.lua"));
+      check(!match("*.c*", "/x.c/foo"));
+      check(!match("[mM]akefile*", "Makefile.d/foo.c"));
+      check(match("[mM]akefile*", "src/makefile.in"));
+      check(!match(".bash[_-]*", ".bash_it/x.sh"));
+      check(match("*", "/x/y"));
+    }
+
+    it("should match the full path when there is a slash") {
+      check(match("*/etc/hosts", "/etc/hosts"));
+      check(!match("*/etc/hosts", "etc/hosts"));
+      check(match("/etc/*.conf", "/etc/a/b.conf"));
+      check(!match("etc/*.conf", "/etc/a.conf"));
+    }
+
+    it("should match character sets and classes") {
+      check(match("*[mM]akefile", "makefile"));
+      check(match("*[mM]akefile", "GNUMakefile"));
+      check(!match("[^a]", "a"));
+      check(match("[^a]", "b"));
+      check(match("[a-c][[:digit:]]", "b7"));
+      check(!match("[a-c][[:digit:]]", "d7"));
+      check(match("\\d\\d", "42"));
+      check(!match("\\d\\d", "4x"));
+      check(match("\\D", "x"));
+      check(match("[-_]", "-"));
+    }
+
+    it("should match branches") {
+      check(match("*.{c,h}", "a.c"));
+      check(match("*.{c,h}", "a.h"));
+      check(!match("*.{c,h}", "a.o"));
+      check(match("a{,b}c", "ac"));
+      check(match("a{,b}c", "abc"));
+      check(match("\\(a\\|b\\)", "b"));
+      check(match("a{b,c{d,e}}f", "acef"));
+      check(!match("a{b,c{d,e}}f", "acf"));
+    }
+
+    it("should match every pattern at the root level") {
+      check(match("*.c,*.h", "a.h"));
+      check(match("*/etc/x,y", "/a/y"));
+      check(!match("*/etc/x,y", "/a/x"));
+      check(!match(",", ""));
+    }
+
+    it("should match quantifiers") {
+      check(match("ab\\*c", "ac"));
+      check(match("ab\\*c", "abbbc"));
+      check(!match("ab\\+c", "ac"));
+      check(match("ab\\+c", "abbc"));
+      check(match("ab\\=c", "ac"));
+      check(!match("ab\\=c", "abbc"));
+      check(match("{ab}\\+", "abab"));
+      check(!match("{ab}\\+", "aba"));
+      check(match("a\\d\\\\\\{2\\}", "a12"));
+      check(!match("a\\d\\\\\\{2\\}", "a1"));
+      check(match("a\\d\\\\\\{1,2\\}", "a1"));
+      check(!match("a\\d\\\\\\{1,2\\}", "a123"));
+      check(match("a\\d\\\\\\{,2\\}", "a"));
+      check(match("a\\d\\\\\\{\\}", "a1234"));
+    }
+
+    it("should ignore case with \\c") {
+      check(match("*.log\\c", "A.LOG"));
+      check(match("*.[a-z]\\c", "a.B"));
+      check(!match("*.log", "A.LOG"));
+      check(!match("*.log\\c,x", "X"));
+    }
+
+    it("should fail on invalid patterns") {
+      check(compile_fail("\\*"));
+      check(compile_fail("*\\+"));
+      check(compile_fail("[[abc]]"));
+    }
+  }
+
+  describe("set") {
+    const char *pats[] = {
+      "*.json",
+      "*/etc/hosts",
+      "Makefile,*.mk",
+      "*.{c,h}",
+      "*",
+      NULL,
+    };
+
+    it("should return the first matching pattern") {
+      check(set_match(pats, "a.json") == 1);
+      check(set_match(pats, "/etc/hosts") == 2);
+      check(set_match(pats, "/src/Makefile") == 3);
+      check(set_match(pats, "/src/a.mk") == 3);
+      check(set_match(pats, "/src/a.h") == 4);
+      check(set_match(pats, "/src/a.o") == 5);
+    }
+
+    it("should prefer patterns added earlier") {
+      check(set_match((const char*[]){ "*.c", "a.c", NULL }, "a.c") == 1);
+      check(set_match((const char*[]){ "a.c", "*.c", NULL }, "a.c") == 1);
+      check(set_match((const char*[]){ "a.c", "*.c", NULL }, "b.c") == 2);
+    }
+
+    it("should match the tail of the path when there is no slash") {
+      check(set_match((const char*[]){ "*/x/a", "a*", NULL }, "/x/a/b") == 0);
+      check(set_match((const char*[]){ "*/x/a", "a*", NULL }, "/x/a") == 1);
+      check(set_match((const char*[]){ "*/x/a", "a*", NULL }, "/y/ab") == 2);
+      check(set_match((const char*[]){ "*vimrc*", NULL }, "/etc/vimrc.d/foo.lua") == 0);
+      check(set_match((const char*[]){ "*vimrc*", NULL }, "/etc/vimrc.d/vimrc.lua") == 1);
+      check(set_match((const char*[]){ "*.txt", "a*", NULL }, "a/b/c") == 0);
+    }
+
+    it("should not filter out patterns by their optional literals") {
+      check(set_match((const char*[]){ "*.{json,yaml}", NULL }, "a.yaml") == 1);
+      check(set_match((const char*[]){ "*.jsonc\\=", NULL }, "a.json") == 1);
+      check(set_match((const char*[]){ "*.LOG\\c", NULL }, "a.log") == 1);
+      check(set_match((const char*[]){ "*.LOG", NULL }, "a.log") == 0);
+      check(set_match((const char*[]){ "[ab]*", "x,*.c", NULL }, "/a/x") == 2);
+    }
+
+    it("should reject literals found only in directories when prefiltering") {
+      const char *pats[] = { "*vimrc*", "*.c", "*/src/*.h" };
+      au_set_t *set = au_set_new();
+      for (size_t i = 0; i < 3; ++i) {
+        token_t *tokens = tokenize(&ctx, pats[i]);
+        check(tokens != NULL && au_set_add(&ctx, set, tokens, i + 1, pats[i]));
+        au_ctx_reset(&ctx);
+      }
+      const char *rejected[] = { "/etc/vimrc.d/foo.lua", "/x.c/foo", "src/a.c/b.h", "a.c/src" };
+      for (size_t i = 0; i < 4; ++i)
+        check(au_set_match_prefiltered(set, rejected[i], strlen(rejected[i])) == NULL);
+      const au_rule_t *rule = au_set_match_prefiltered(set, "/x.c/a.c", 8);
+      check(rule != NULL && rule->lnum == 2);
+      au_set_free(set);
+    }
+
+    it("should return nothing when nothing matches") {
+      check(set_match((const char*[]){ "*.c", NULL }, "a.h") == 0);
+      check(set_match((const char*[]){ NULL }, "a.h") == 0);
+    }
+  }
+
+  describe("autocmd") {
+    it("should match autocmd names") {
+      check(match_autocmd("au", 2));
+      check(match_autocmd("au!", 3));
+      check(match_autocmd("autocmd", 7));
+      check(match_autocmd("autoc!", 6));
+      check(match_autocmd("autocmd ", 7));
+      check(!match_autocmd("a", 1));
+      check(!match_autocmd("augroup", 7));
+      check(!match_autocmd("autocmds", 8));
+    }
+
+    it("should match events") {
+      check(match_events("BufNewFile,BufRead", 18));
+      check(match_events("bufreadpost,bufnewfile", 22));
+      check(!match_events("BufNewFile,BufRead", 10));
+      check(!match_events("BufRead", 7));
+      check(!match_events("BufNewFile,BufReadCmd", 21));
+    }
+  }
+
+  describe("buffer") {
+    it("should append and escape") {
+      au_buf_t buf = {0};
+      au_buf_puts(&buf, "{\"a\":");
+      au_buf_putu(&buf, 0);
+      au_buf_putc(&buf, ',');
+      au_buf_putu(&buf, 18446744073709551615UL);
+      au_buf_pad(&buf, 2);
+      au_buf_escape(&buf, "x\\\"y", 4);
+      au_buf_putc(&buf, '\0');
+      check(!buf.failed);
+      check(strcmp(buf.data, "{\"a\":0,18446744073709551615  x\\\\\\\"y") == 0);
+      au_buf_free(&buf);
+    }
+
+    it("should ignore empty data") {
+      au_buf_t buf = {0};
+      au_buf_put(&buf, NULL, 0);
+      check(!buf.failed && buf.size == 0 && buf.data == NULL);
+      au_buf_put(&buf, "a", 1);
+      au_buf_put(&buf, NULL, 0);
+      check(!buf.failed && buf.size == 1);
+      au_buf_free(&buf);
+    }
+
+    it("should escape control characters") {
+      au_buf_t buf = {0};
+      au_buf_escape(&buf, "a\tb\nc\r\x01\x1f\x7f\b\f", 11);
+      au_buf_putc(&buf, '\0');
+      check(strcmp(buf.data, "a\\tb\\nc\\r\\u0001\\u001f\x7f\\b\\f") == 0);
+      au_buf_free(&buf);
+    }
+
+    it("should escape long strings") {
+      // special characters at every position of a vector
+      char str[300];
+      for (size_t i = 0; i < sizeof(str); ++i)
+        str[i] = i % 37 == 0 ? '"' : i % 41 == 0 ? '\\' : i % 43 == 0 ? '\n' : 'a' + i % 26;
+      au_buf_t buf = {0};
+      au_buf_escape(&buf, str, sizeof(str));
+      size_t n = 0;
+      bool ok = true;
+      for (size_t i = 0; i < sizeof(str) && ok; ++i) {
+        if (str[i] == '"' || str[i] == '\\' || str[i] == '\n') {
+          ok = buf.data[n] == '\\' && buf.data[n + 1] == (str[i] == '\n' ? 'n' : str[i]);
+          n += 2;
+        } else {
+          ok = buf.data[n++] == str[i];
+        }
+      }
+      check(ok && n == buf.size);
+
+      char out[700];
+      check(write_escaped(out, sizeof(out), str, sizeof(str)) == (int)buf.size);
+      check(memcmp(out, buf.data, buf.size) == 0 && out[buf.size] == '\0');
+      check(write_escaped(out, buf.size, str, sizeof(str)) == -1);
+      au_buf_free(&buf);
+    }
+
+    it("should grow and flush") {
+      au_buf_t buf = {0};
+      for (size_t i = 0; i < 10000; ++i)
+        au_buf_puts(&buf, "0123456789");
+      check(buf.size == 100000);
+      int fds[2];
+      check(pipe(fds) == 0);
+      au_buf_t small = {0};
+      au_buf_puts(&small, "hello");
+      check(au_buf_flush(&small, fds[1]));
+      check(small.size == 0);
+      char tmp[8] = {0};
+      check(read(fds[0], tmp, sizeof(tmp)) == 5);
+      check(strcmp(tmp, "hello") == 0);
+      close(fds[0]);
+      close(fds[1]);
+      au_buf_free(&small);
+      au_buf_free(&buf);
+    }
+  }
+
+  describe("cache") {
+    it("should reuse results of repeated patterns") {
+      au_cache_t cache;
+      au_cache_init(&cache);
+      char pat[] = "*.{c,h}x";
+      const au_cache_entry_t *a = au_cache_get(&ctx, &cache, pat, 7, true);
+      au_ctx_reset(&ctx);
+      check(a != NULL && a->error == NULL);
+      check(strcmp(a->pat, "*.{c,h}") == 0);
+      check(a->nres == 2);
+      check(a->res[0][0]->beg == a->pat && a->res[2] == NULL);
+
+      // same bytes, different memory
+      pat[0] = '\0';
+      const au_cache_entry_t *b = au_cache_get(&ctx, &cache, "*.{c,h}", 7, true);
+      check(b == a);
+      check(cache.hits == 1 && cache.misses == 1 && cache.size == 1);
+
+      const token_t *toks = tokenize(&ctx, "*.{c,h}");
+      size_t i = 0;
+      for (; toks[i].type; ++i) {
+        check(a->toks[i].type == toks[i].type && a->toks[i].len == toks[i].len);
+        check(strncmp(a->toks[i].beg, toks[i].beg, toks[i].len) == 0);
+      }
+      check(a->toks[i].type == End);
+      au_ctx_reset(&ctx);
+
+      check(a->data == NULL);
+      check(au_cache_set_data(&cache, a, "abc", 3));
+      check(a->size == 3 && memcmp(a->data, "abc", 3) == 0);
+      au_cache_free(&cache);
+    }
+
+    it("should cache errors") {
+      au_cache_t cache;
+      au_cache_init(&cache);
+      const au_cache_entry_t *a = au_cache_get(&ctx, &cache, "a{b", 3, true);
+      check(a != NULL && a->toks == NULL);
+      check(strcmp(a->error, "unclosed branch") == 0);
+      check(au_cache_get(&ctx, &cache, "a{b", 3, true) == a);
+
+      ctx.unroll_max = 1;
+      a = au_cache_get(&ctx, &cache, "{a,b}", 5, true);
+      check(a != NULL && a->toks != NULL && a->res == NULL);
+      check(strcmp(a->error, "too many branches") == 0);
+      ctx.unroll_max = 0;
+      au_ctx_reset(&ctx);
+      au_cache_free(&cache);
+    }
+
+    it("should keep many entries") {
+      au_cache_t cache;
+      au_cache_init(&cache);
+      char buf[32];
+      for (int k = 0; k < 2; ++k) {
+        for (int i = 0; i < 1000; ++i) {
+          int len = snprintf(buf, sizeof(buf), "*.{x%d,y}", i);
+          const au_cache_entry_t *e = au_cache_get(&ctx, &cache, buf, len, k == 1);
+          au_ctx_reset(&ctx);
+          check(e != NULL && strcmp(e->pat, buf) == 0);
+          check(k == 0 ? e->res == NULL : e->nres == 2);
+        }
+      }
+      check(cache.size == 1000 && cache.hits == 1000 && cache.misses == 1000);
+      au_cache_free(&cache);
+    }
+
+    it("should load results from a store") {
+      // tokenize error, unroll error, a long branch, and one that isn't
+      // unrolled before it's saved
+      const char *pats[] = { "*.{c,h}", "a{b", "", NULL, "p{q,r}" };
+      char *deep = malloc(300 + 5);
+      memcpy(deep, "{a,", 3);
+      memset(deep + 3, '?', 300);
+      memcpy(deep + 303, "}", 2);
+      pats[3] = deep;
+
+      au_cache_t cache;
+      au_cache_init(&cache);
+      for (size_t i = 0; i < 5; ++i) {
+        check(au_cache_get(&ctx, &cache, pats[i], strlen(pats[i]), i < 4) != NULL);
+        au_ctx_reset(&ctx);
+      }
+      au_bin_writer_t w = {0};
+      au_cache_save(&cache, &w);
+      au_buf_t out = {0};
+      check(au_bin_finish(&w, &out));
+      char path[] = "/tmp/auparser-test-XXXXXX";
+      int fd = mkstemp(path);
+      check(fd >= 0);
+      check(au_buf_flush(&out, fd));
+      close(fd);
+
+      au_store_t store;
+      const char *error = NULL;
+      check(au_store_open(&store, path, &error));
+      unlink(path);
+      au_cache_t loaded;
+      au_cache_init(&loaded);
+      loaded.store = &store;
+      for (size_t i = 0; i < 5; ++i) {
+        const au_cache_entry_t *a = au_cache_get(&ctx, &cache, pats[i], strlen(pats[i]), true);
+        const au_cache_entry_t *b = au_cache_get(&ctx, &loaded, pats[i], strlen(pats[i]), true);
+        au_ctx_reset(&ctx);
+        check(b != NULL && b->unrolled == a->unrolled);
+        check((a->error == NULL) == (b->error == NULL));
+        check(a->error == NULL || strcmp(a->error, b->error) == 0);
+        check((a->toks == NULL) == (b->toks == NULL) && a->nres == b->nres);
+        for (size_t j = 0; j < a->nres; ++j) {
+          size_t k = 0;
+          for (; a->res[j][k] != NULL; ++k) {
+            check(b->res[j][k] != NULL && b->res[j][k]->type == a->res[j][k]->type);
+            check(b->res[j][k]->len == a->res[j][k]->len);
+            check(strncmp(b->res[j][k]->beg, a->res[j][k]->beg, a->res[j][k]->len) == 0);
+          }
+          check(b->res[j][k] == NULL);
+        }
+      }
+      // failing to start unrolling depends on the context, it's not stored
+      check(loaded.loaded == 4 && loaded.misses == 5);
+      check(strcmp(au_cache_get(&ctx, &loaded, "a{b", 3, true)->error, "unclosed branch") == 0);
+      check(au_cache_get(&ctx, &loaded, deep, strlen(deep), true)->nres == 2);
+      check(au_cache_get(&ctx, &loaded, "p{q,r}", 6, true)->nres == 2);
+
+      au_cache_free(&loaded);
+      au_store_close(&store);
+      au_buf_free(&out);
+      au_bin_free(&w);
+      au_cache_free(&cache);
+      free(deep);
+    }
+
+    it("should store branches of entries unrolled after loading") {
+      au_cache_t cache;
+      au_cache_init(&cache);
+      check(au_cache_get(&ctx, &cache, "p{q,r}", 6, false) != NULL);
+      au_bin_writer_t w = {0};
+      au_cache_save(&cache, &w);
+      au_buf_t out = {0};
+      check(au_bin_finish(&w, &out));
+      char path[] = "/tmp/auparser-test-XXXXXX";
+      int fd = mkstemp(path);
+      check(fd >= 0);
+      check(au_buf_flush(&out, fd));
+      close(fd);
+
+      // tokenize only entry, unrolled on the next run and saved again
+      au_store_t store;
+      const char *error = NULL;
+      check(au_store_open(&store, path, &error));
+      au_cache_t loaded;
+      au_cache_init(&loaded);
+      loaded.store = &store;
+      const au_cache_entry_t *e = au_cache_get(&ctx, &loaded, "p{q,r}", 6, true);
+      check(e != NULL && loaded.loaded == 1 && e->unrolled && e->nres == 2);
+      au_bin_writer_t w2 = {0};
+      au_cache_save(&loaded, &w2);
+      au_buf_t out2 = {0};
+      check(au_bin_finish(&w2, &out2));
+      unlink(path);
+      char path2[] = "/tmp/auparser-test-XXXXXX";
+      fd = mkstemp(path2);
+      check(fd >= 0);
+      check(au_buf_flush(&out2, fd));
+      close(fd);
+
+      au_store_t store2;
+      check(au_store_open(&store2, path2, &error));
+      unlink(path2);
+      au_cache_t reloaded;
+      au_cache_init(&reloaded);
+      reloaded.store = &store2;
+      e = au_cache_get(&ctx, &reloaded, "p{q,r}", 6, false);
+      check(e != NULL && reloaded.loaded == 1 && e->unrolled && e->nres == 2);
+      au_ctx_reset(&ctx);
+
+      au_cache_free(&reloaded);
+      au_store_close(&store2);
+      au_cache_free(&loaded);
+      au_store_close(&store);
+      au_buf_free(&out2);
+      au_bin_free(&w2);
+      au_buf_free(&out);
+      au_bin_free(&w);
+      au_cache_free(&cache);
+    }
+
+    it("should apply the branch limit to stored results") {
+      au_cache_t cache;
+      au_cache_init(&cache);
+      check(au_cache_get(&ctx, &cache, "{a,b}{c,d}", 10, true)->nres == 4);
+      au_ctx_reset(&ctx);
+      au_bin_writer_t w = {0};
+      au_cache_save(&cache, &w);
+      au_buf_t out = {0};
+      check(au_bin_finish(&w, &out));
+      char path[] = "/tmp/auparser-test-XXXXXX";
+      int fd = mkstemp(path);
+      check(fd >= 0);
+      check(au_buf_flush(&out, fd));
+      close(fd);
+
+      au_store_t store;
+      const char *error = NULL;
+      check(au_store_open(&store, path, &error));
+      unlink(path);
+      au_cache_t loaded;
+      au_cache_init(&loaded);
+      loaded.store = &store;
+      ctx.unroll_max = 2;
+      const au_cache_entry_t *e = au_cache_get(&ctx, &loaded, "{a,b}{c,d}", 10, true);
+      check(e != NULL && loaded.loaded == 1);
+      check(e->toks != NULL && e->res == NULL);
+      check(e->error != NULL && strcmp(e->error, "too many branches") == 0);
+      ctx.unroll_max = 0;
+      au_ctx_reset(&ctx);
+
+      au_cache_free(&loaded);
+      au_store_close(&store);
+      au_buf_free(&out);
+      au_bin_free(&w);
+      au_cache_free(&cache);
+    }
+
+    it("should tell when there's no store") {
+      au_store_t store;
+      const char *error = NULL;
+      check(!au_store_open(&store, "/nonexistent/auparser-store", &error));
+      check(error != NULL && strcmp(error, AU_STORE_MISSING) == 0);
+      char path[] = "/tmp/auparser-test-XXXXXX";
+      int fd = mkstemp(path);
+      check(fd >= 0);
+      close(fd);
+      check(!au_store_open(&store, path, &error));
+      check(strcmp(error, "empty file") == 0);
+      unlink(path);
+    }
+
+    it("should reject stores of other parser versions") {
+      au_cache_t cache;
+      au_cache_init(&cache);
+      check(au_cache_get(&ctx, &cache, "*.{c,h}", 7, true) != NULL);
+      au_ctx_reset(&ctx);
+      au_bin_writer_t w = {0};
+      au_cache_save(&cache, &w);
+      au_buf_t out = {0};
+      check(au_bin_finish(&w, &out));
+      ((au_bin_header_t *)out.data)->parser = AU_PARSER_VERSION + 1;
+      char path[] = "/tmp/auparser-test-XXXXXX";
+      int fd = mkstemp(path);
+      check(fd >= 0);
+      check(au_buf_flush(&out, fd));
+      close(fd);
+
+      au_store_t store;
+      const char *error = NULL;
+      check(!au_store_open(&store, path, &error));
+      check(error != NULL && strcmp(error, "parser version mismatch") == 0);
+      unlink(path);
+      au_buf_free(&out);
+      au_bin_free(&w);
+      au_cache_free(&cache);
+    }
+  }
+
+  describe("context") {
+    it("should keep errors separate") {
+      au_ctx_t a, b;
+      au_ctx_init(&a);
+      au_ctx_init(&b);
+      check(tokenize(&a, "[") == NULL);
+      check(tokenize(&b, "{") == NULL);
+      check(strcmp(a.error, "unclosed '['") == 0);
+      check(strcmp(b.error, "unclosed branch") == 0);
+      au_ctx_free(&a);
+      au_ctx_free(&b);
+    }
+
+    it("should reuse memory after reset") {
+      au_ctx_t a;
+      au_ctx_init(&a);
+      token_t *t1 = tokenize(&a, "*.{c,h}");
+      check(t1 != NULL);
+      check(unroll(&a, t1) != NULL);
+      size_t size = a.arena.size;
+      au_ctx_reset(&a);
+      token_t *t2 = tokenize(&a, "*.{c,h}");
+      check(t2 == t1);
+      check(unroll(&a, t2) != NULL);
+      check(a.arena.size == size);
+      au_ctx_free(&a);
+    }
+  }
+
+  describe("arena") {
+    it("should resize the last allocation in place") {
+      au_arena_t arena = {0};
+      char *a = au_arena_alloc(&arena, 10);
+      check(a != NULL);
+      memcpy(a, "abcdefghi", 10);
+      check(au_arena_realloc(&arena, a, 10, 100) == a);
+      char *b = au_arena_alloc(&arena, 10);
+      check(b != NULL && b != a);
+      char *c = au_arena_realloc(&arena, a, 100, 200);
+      check(c != NULL && c != a && strcmp(c, "abcdefghi") == 0);
+      au_arena_free(&arena);
+    }
+
+    it("should handle allocations bigger than a chunk") {
+      au_arena_t arena = {0};
+      char *a = au_arena_alloc(&arena, 16);
+      char *b = au_arena_alloc(&arena, 1 << 20);
+      check(a != NULL && b != NULL);
+      memset(b, 'x', 1 << 20);
+      au_arena_reset(&arena);
+      size_t size = arena.size;
+      check(au_arena_alloc(&arena, 16) != NULL);
+      check(au_arena_alloc(&arena, 1 << 20) != NULL);
+      check(arena.size == size);
+      au_arena_free(&arena);
+    }
+  }
+
+  describe("binary") {
+    it("should read back what was written") {
+      au_bin_writer_t w = {0};
+      const char *pat = "*.{c,h}";
+      const char *bad = "a{b";
+      check(au_bin_add(&ctx, &w, &(au_bin_source_t){ pat, strlen(pat), "setf c", 6, "ft.vim", 3 }, AU_BIN_UNROLLED));
+      check(!au_bin_add(&ctx, &w, &(au_bin_source_t){ bad, strlen(bad), NULL, 0, "ft.vim", 4 }, AU_BIN_UNROLLED));
+      au_ctx_reset(&ctx);
+
+      au_buf_t out = {0};
+      check(au_bin_finish(&w, &out));
+      au_bin_t bin;
+      const char *error = NULL;
+      check(au_bin_open(&bin, out.data, out.size, &error));
+      check(bin.header->npatterns == 2);
+      check(bin.header->nbranches == 2);
+
+      const au_bin_pattern_t *p = &bin.patterns[0];
+      check(au_bin_str(&bin, p->pattern) != NULL && strncmp(au_bin_str(&bin, p->pattern), pat, p->pattern.len) == 0);
+      check(strncmp(au_bin_str(&bin, p->cmd), "setf c", p->cmd.len) == 0);
+      check(strncmp(au_bin_str(&bin, p->file), "ft.vim", p->file.len) == 0);
+      check(p->lnum == 3 && p->error.off == AU_BIN_NONE);
+      check(p->flags == AU_BIN_UNROLLED && bin.patterns[1].flags == 0);
+
+      token_t *toks = tokenize(&ctx, pat);
+      check(p->ntokens == 7);
+      for (uint32_t i = 0; i < p->ntokens; ++i) {
+        const au_bin_token_t *t = &bin.tokens[p->tokens + i];
+        check(t->type == toks[i].type && t->lvl == toks[i].lvl);
+        check(t->value.len == toks[i].len && strncmp(au_bin_str(&bin, t->value), toks[i].beg, t->value.len) == 0);
+      }
+      au_ctx_reset(&ctx);
+
+      const char *expected[] = { "*.c", "*.h" };
+      for (uint32_t i = 0; i < p->nbranches; ++i) {
+        const au_bin_branch_t *br = &bin.branches[p->branches + i];
+        char res[16] = {0};
+        for (uint32_t j = 0; j < br->nrefs; ++j) {
+          const au_bin_token_t *t = &bin.tokens[bin.refs[br->refs + j]];
+          strncat(res, au_bin_str(&bin, t->value), t->value.len);
+        }
+        check(strcmp(res, expected[i]) == 0);
+      }
+
+      p = &bin.patterns[1];
+      check(p->cmd.off == AU_BIN_NONE && p->nbranches == 0);
+      check(p->file.off == bin.patterns[0].file.off);
+      check(strncmp(au_bin_str(&bin, p->error), "unclosed branch", p->error.len) == 0);
+
+      au_buf_free(&out);
+      au_bin_free(&w);
+    }
+
+    it("should append writers") {
+      au_bin_writer_t a = {0}, b = {0};
+      check(au_bin_add(&ctx, &a, &(au_bin_source_t){ "x{1,2}", 6, NULL, 0, "a.vim", 1 }, AU_BIN_UNROLLED));
+      check(au_bin_add(&ctx, &b, &(au_bin_source_t){ "y{3,4}", 6, NULL, 0, "b.vim", 1 }, AU_BIN_UNROLLED | AU_BIN_FACTORIZED));
+      au_ctx_reset(&ctx);
+      au_bin_append(&a, &b);
+      check(b.patterns.size == 0);
+
+      au_buf_t out = {0};
+      check(au_bin_finish(&a, &out));
+      au_bin_t bin;
+      const char *error = NULL;
+      check(au_bin_open(&bin, out.data, out.size, &error));
+      check(bin.header->npatterns == 2 && bin.header->nbranches == 4);
+      const au_bin_pattern_t *p = &bin.patterns[1];
+      check(strncmp(au_bin_str(&bin, p->pattern), "y{3,4}", p->pattern.len) == 0);
+      check(strncmp(au_bin_str(&bin, p->file), "b.vim", p->file.len) == 0);
+      const au_bin_branch_t *br = &bin.branches[p->branches + 1];
+      check(br->nrefs == 2);
+      check(strncmp(au_bin_str(&bin, bin.tokens[bin.refs[br->refs + 1]].value), "4", 1) == 0);
+
+      // root group is y{3,4}, its only sequence is y and the inner group
+      check(bin.patterns[0].ngroups == 0 && p->ngroups == 2);
+      check(p->flags == (AU_BIN_UNROLLED | AU_BIN_FACTORIZED));
+      const au_dag_group_t *root = &bin.groups[p->groups + 1];
+      check(root->nseqs == 1 && bin.seqs[root->seqs].nitems == 2);
+      const uint32_t *items = &bin.items[bin.seqs[root->seqs].items];
+      check(strncmp(au_bin_str(&bin, bin.tokens[items[0]].value), "y", 1) == 0);
+      check(items[1] == (AU_DAG_GROUP | p->groups));
+      const au_dag_group_t *inner = &bin.groups[p->groups];
+      check(inner->nseqs == 2 && bin.seqs[inner->seqs + 1].nitems == 1);
+      uint32_t tok = bin.items[bin.seqs[inner->seqs + 1].items];
+      check(strncmp(au_bin_str(&bin, bin.tokens[tok].value), "4", 1) == 0);
+      au_buf_free(&out);
+      au_bin_free(&a);
+    }
+
+    it("should append copies of writers") {
+      // like output merged from workers, kept for writing it again
+      au_bin_writer_t jobs[2];
+      memset(jobs, 0, sizeof(jobs));
+      check(au_bin_add(&ctx, &jobs[0], &(au_bin_source_t){ "x{1,{2,3}}", 10, NULL, 0, "a.vim", 1 }, AU_BIN_UNROLLED | AU_BIN_FACTORIZED));
+      check(au_bin_add(&ctx, &jobs[1], &(au_bin_source_t){ "y{4,5}", 6, NULL, 0, "b.vim", 1 }, AU_BIN_UNROLLED | AU_BIN_FACTORIZED));
+      au_ctx_reset(&ctx);
+      for (int k = 0; k < 2; ++k) {
+        au_bin_writer_t w = {0};
+        au_bin_append_copy(&w, &jobs[0]);
+        au_bin_append_copy(&w, &jobs[1]);
+        check(jobs[1].patterns.size > 0 && jobs[1].groups.size > 0);
+
+        au_buf_t out = {0};
+        check(au_bin_finish(&w, &out));
+        au_bin_t bin;
+        const char *error = NULL;
+        check(au_bin_open(&bin, out.data, out.size, &error));
+        check(bin.header->npatterns == 2 && bin.header->nbranches == 5 && bin.header->ngroups == 5);
+        const au_bin_pattern_t *p = &bin.patterns[1];
+        check(p->groups == 3 && p->ngroups == 2);
+        const au_dag_group_t *root = &bin.groups[p->groups + 1];
+        const uint32_t *items = &bin.items[bin.seqs[root->seqs].items];
+        check(strncmp(au_bin_str(&bin, bin.tokens[items[0]].value), "y", 1) == 0);
+        check(items[1] == (AU_DAG_GROUP | p->groups));
+        au_buf_free(&out);
+        au_bin_free(&w);
+      }
+      au_bin_free(&jobs[0]);
+      au_bin_free(&jobs[1]);
+    }
+
+    it("should reject invalid data") {
+      au_bin_writer_t w = {0};
+      check(au_bin_add(&ctx, &w, &(au_bin_source_t){ "a", 1, NULL, 0, NULL, 1 }, 0));
+      au_ctx_reset(&ctx);
+      au_buf_t out = {0};
+      check(au_bin_finish(&w, &out));
+      au_bin_t bin;
+      const char *error = NULL;
+      check(!au_bin_open(&bin, out.data, out.size - 1, &error));
+      check(strcmp(error, "invalid file size") == 0);
+      out.data[0] = 'X';
+      check(!au_bin_open(&bin, out.data, out.size, &error));
+      check(strcmp(error, "not a binary pattern file") == 0);
+      au_buf_free(&out);
+      au_bin_free(&w);
     }
   }
 }